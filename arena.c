@@ -0,0 +1,94 @@
+/**
+  Bump allocator
+*/
+
+#include "arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+void arena_init(struct Arena *arena) { memset(arena, 0, sizeof(*arena)); }
+
+/**
+ * @brief Allocate size bytes aligned to align (a power of two)
+ * a new block is started when the current one is full; requests larger
+ * than a block get a block of their own
+ * @param arena
+ * @param size
+ * @param align
+ * @return void* NULL on allocation failure
+ */
+void *arena_alloc(struct Arena *arena, size_t size, size_t align) {
+  struct ArenaBlock *block = arena->blocks;
+  if (block != NULL) {
+    size_t start = (block->used + align - 1) & ~(align - 1);
+    if (start + size <= block->size) {
+      arena->used += start - block->used + size;
+      block->used = start + size;
+      return block->data + start;
+    }
+  }
+
+  size_t block_size = ARENA_BLOCK_SIZE;
+  if (size + align > block_size) {
+    block_size = size + align;
+  }
+  block = malloc(sizeof(struct ArenaBlock) + block_size);
+  if (block == NULL) {
+    return NULL;
+  }
+  block->size = block_size;
+  block->used = 0;
+  block->next = arena->blocks;
+  arena->blocks = block;
+  arena->reserved += sizeof(struct ArenaBlock) + block_size;
+
+  return arena_alloc(arena, size, align);
+}
+
+/**
+ * @brief Copy len bytes of str into the arena as a NUL terminated string
+ * @param arena
+ * @param str
+ * @param len
+ * @return char* NULL on allocation failure
+ */
+char *arena_strndup(struct Arena *arena, const char *str, size_t len) {
+  char *copy = arena_alloc(arena, len + 1, 1);
+  if (copy != NULL) {
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+  }
+  return copy;
+}
+
+/**
+ * @brief Move every block of src into dest
+ * memory handed out by src stays valid and is now freed with dest
+ * @param dest
+ * @param src
+ */
+void arena_merge(struct Arena *dest, struct Arena *src) {
+  if (src->blocks == NULL) {
+    return;
+  }
+  struct ArenaBlock *tail = src->blocks;
+  while (tail->next != NULL) {
+    tail = tail->next;
+  }
+  tail->next = dest->blocks;
+  dest->blocks = src->blocks;
+  dest->used += src->used;
+  dest->reserved += src->reserved;
+  arena_init(src);
+}
+
+void arena_free(struct Arena *arena) {
+  struct ArenaBlock *block = arena->blocks;
+  while (block != NULL) {
+    struct ArenaBlock *next = block->next;
+    free(block);
+    block = next;
+  }
+  arena_init(arena);
+}
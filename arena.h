@@ -0,0 +1,35 @@
+/**
+  Bump allocator
+
+  Memory is handed out from large blocks and only released all at once with
+  arena_free, which suits data that lives exactly as long as its owner
+  (e.g. every string of a question bank).
+*/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+struct ArenaBlock {
+  struct ArenaBlock *next;
+  size_t size;
+  size_t used;
+  char data[];
+};
+
+struct Arena {
+  struct ArenaBlock *blocks;
+  size_t used;     // bytes handed out
+  size_t reserved; // bytes allocated from the system
+};
+
+void arena_init(struct Arena *arena);
+void *arena_alloc(struct Arena *arena, size_t size, size_t align);
+char *arena_strndup(struct Arena *arena, const char *str, size_t len);
+void arena_merge(struct Arena *dest, struct Arena *src);
+void arena_free(struct Arena *arena);
+
+#endif
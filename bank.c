@@ -0,0 +1,1041 @@
+/**
+  Question banks
+*/
+
+#include "bank.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+char *QUESTION_DELIM = " ";
+// entries whose table slots are prefetched together while deduplicating
+#define DEDUP_BATCH 16
+
+/**
+  Growable byte buffer used to lay out compiled banks
+ */
+struct Buffer {
+  char *data;
+  size_t size;
+  size_t capacity;
+};
+
+/**
+ * @brief Append len bytes to a buffer, growing it as needed
+ * @return int 0 on success, -1 on allocation failure
+ */
+static int buffer_append(struct Buffer *buffer, const void *src, size_t len) {
+  if (buffer->size + len > buffer->capacity) {
+    size_t capacity = buffer->capacity ? buffer->capacity : 4096;
+    while (buffer->size + len > capacity) {
+      capacity *= 2;
+    }
+    char *grown = realloc(buffer->data, capacity);
+    if (grown == NULL) {
+      return -1;
+    }
+    buffer->data = grown;
+    buffer->capacity = capacity;
+  }
+  memcpy(buffer->data + buffer->size, src, len);
+  buffer->size += len;
+  return 0;
+}
+
+/**
+ * @brief Encode the QUESTION_SEND frame for a question
+ * @return int frame length
+ */
+static int encode_question(char *dest, size_t size, int index,
+                           struct Entry *entry) {
+  return frame_printf(dest, size, "%d|%d|%s|%s|%s|%s", QUESTION_SEND, index,
+                      entry->prompt, entry->options[0], entry->options[1],
+                      entry->options[2]);
+}
+
+/**
+ * @brief Check that an entry's frames fit in FRAME_MAX
+ * the question frame is the longer one: its type, a bank index of at most
+ * 10 digits, five delimiters, the prompt and the options
+ * @return int 1 if the entry can be encoded whole
+ */
+static int entry_fits(struct Entry *entry) {
+  size_t length = 1 + 10 + 5 + strlen(entry->prompt);
+  for (int i = 0; i < 3; i++) {
+    length += strlen(entry->options[i]);
+  }
+  return length <= FRAME_MAX;
+}
+
+/**
+ * @brief Encode the ANSWER_BROADCAST frame for a question
+ * @return int frame length
+ */
+static int encode_answer(char *dest, size_t size, struct Entry *entry) {
+  return frame_printf(dest, size, "%d|%s", ANSWER_BROADCAST,
+                      entry->options[entry->answer_idx]);
+}
+
+/**
+ * @brief Copy an encoded frame into the arena as a pinned OutBuf
+ * @return struct OutBuf* NULL on allocation failure
+ */
+static struct OutBuf *pin_frame(struct Arena *arena, char *frame,
+                                size_t length) {
+  struct OutBuf *buf =
+      arena_alloc(arena, sizeof(struct OutBuf) + length, sizeof(size_t));
+  if (buf != NULL) {
+    buf->refs = OUTBUF_PINNED;
+    buf->length = length;
+    memcpy(buf->data, frame, length);
+  }
+  return buf;
+}
+
+/**
+  Load-time index of distinct strings by content. Text banks intern their
+  strings through it (one stored copy per distinct string) and compiling
+  lays each distinct string into the pool once. Sized up front, never
+  grows: capacity is at least twice the strings it will hold.
+ */
+struct StringSlot {
+  const char *str; // NULL marks an empty slot
+  uint32_t hash;   // low bits of the content hash
+  uint32_t value;  // owner's data: pool offset when compiling
+};
+
+struct StringTable {
+  struct StringSlot *slots;
+  size_t mask;
+};
+
+/**
+ * @brief 64-bit content hash, eight bytes per step
+ */
+static uint64_t hash_bytes(const char *str, size_t len) {
+  uint64_t hash = len * 0x9e3779b97f4a7c15ULL;
+  uint64_t word;
+  for (; len >= 8; str += 8, len -= 8) {
+    memcpy(&word, str, 8);
+    hash = (hash ^ word) * 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 32;
+  }
+  word = 0;
+  memcpy(&word, str, len);
+  hash ^= word;
+  hash = (hash ^ (hash >> 33)) * 0xff51afd7ed558ccdULL;
+  hash = (hash ^ (hash >> 33)) * 0xc4ceb9fe1a85ec53ULL;
+  return hash ^ (hash >> 33);
+}
+
+/**
+ * @brief Mix one more 64-bit value into a hash
+ */
+static uint64_t hash_combine(uint64_t hash, uint64_t value) {
+  hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+  return hash;
+}
+
+static int strings_init(struct StringTable *table, size_t expected) {
+  size_t capacity = 16;
+  while (capacity < expected * 2) {
+    capacity *= 2;
+  }
+  table->slots = calloc(capacity, sizeof(struct StringSlot));
+  table->mask = capacity - 1;
+  return table->slots != NULL ? 0 : -1;
+}
+
+/**
+ * @brief Slot holding str, or the empty slot where it belongs
+ */
+static struct StringSlot *strings_find(struct StringTable *table,
+                                       const char *str, size_t len,
+                                       uint64_t hash) {
+  for (size_t i = hash & table->mask;; i = (i + 1) & table->mask) {
+    struct StringSlot *slot = &table->slots[i];
+    if (slot->str == NULL ||
+        (slot->hash == (uint32_t)hash && strncmp(slot->str, str, len) == 0 &&
+         slot->str[len] == '\0')) {
+      return slot;
+    }
+  }
+}
+
+static void strings_free(struct StringTable *table) {
+  free(table->slots);
+  table->slots = NULL;
+}
+
+/**
+  Parse state for one chunk of a text question file.
+  Chunks start on a record boundary and are parsed independently; line
+  numbers are chunk relative until the chunks are merged.
+ */
+struct ChunkParse {
+  const char *start;
+  const char *end;
+  int num_lines;
+  struct Arena arena;   // pinned frames
+  struct Arena strings; // parsed strings until they are interned
+  struct Entry *entries;
+  int *lines; // chunk relative line of each entry's prompt
+  int count;
+  int kept; // entries left once duplicates are dropped
+  int capacity;
+  struct ParseError *errors;
+  int num_errors;
+  int error_capacity;
+  // filled in once every chunk has been parsed
+  int base;
+  struct QuestionBank *bank;
+};
+
+/**
+ * @brief Split a line into arena strings by delimiter
+ * only the first three fields are kept
+ * @param arena
+ * @param dest
+ * @param str
+ * @param len
+ * @param delim
+ * @return int
+ */
+int split_option(struct Arena *arena, const char *dest[3], const char *str,
+                 size_t len, char delim) {
+  const char *end = str + len;
+  int result_pos = 0;
+
+  // string spot
+  while (1) {
+    const char *found = memchr(str, delim, end - str);
+    const char *field_end = found != NULL ? found : end;
+    if (result_pos < 3) {
+      dest[result_pos] = arena_strndup(arena, str, field_end - str);
+      result_pos++;
+    }
+    if (found == NULL) {
+      break;
+    }
+    str = found + 1;
+  }
+
+  return result_pos + 1;
+}
+
+/**
+ * @brief Record a parse error for the chunk and keep going
+ * @param chunk
+ * @param line_num chunk relative line number
+ * @param reason
+ */
+static void parse_error(struct ChunkParse *chunk, int line_num, char *reason) {
+  if (chunk->num_errors == chunk->error_capacity) {
+    int capacity = chunk->error_capacity ? chunk->error_capacity * 2 : 16;
+    struct ParseError *errors =
+        realloc(chunk->errors, sizeof(struct ParseError) * capacity);
+    if (errors == NULL) {
+      return;
+    }
+    chunk->errors = errors;
+    chunk->error_capacity = capacity;
+  }
+  chunk->errors[chunk->num_errors].line = line_num;
+  chunk->errors[chunk->num_errors].reason = reason;
+  chunk->num_errors++;
+}
+
+/**
+ * @brief Make room for one more entry in a chunk
+ * @param chunk
+ * @return struct Entry* the new (uninitialized) entry
+ */
+static struct Entry *chunk_next_entry(struct ChunkParse *chunk) {
+  if (chunk->count == chunk->capacity) {
+    int capacity = chunk->capacity ? chunk->capacity * 2 : 64;
+    struct Entry *entries =
+        realloc(chunk->entries, sizeof(struct Entry) * capacity);
+    int *lines = entries != NULL
+                     ? realloc(chunk->lines, sizeof(int) * capacity)
+                     : NULL;
+    if (entries == NULL || lines == NULL) {
+      fprintf(stderr, "Failed to allocate question storage.\n");
+      exit(1);
+    }
+    chunk->entries = entries;
+    chunk->lines = lines;
+    chunk->capacity = capacity;
+  }
+  return &chunk->entries[chunk->count];
+}
+
+/**
+ * @brief Parse every record in one chunk (thread entry point)
+ * a malformed record is reported and skipped up to the next separator
+ * line, so one bad record does not stop the rest of the file
+ * @param arg struct ChunkParse
+ * @return void*
+ */
+static void *parse_chunk(void *arg) {
+  struct ChunkParse *chunk = arg;
+  const char *cursor = chunk->start;
+  int line_num = 1;
+  struct Entry *this_entry = NULL;
+
+  /**
+   * change behavior based on line number
+   * 0 -> line separator
+   * 1 -> prompt (string)
+   * 2 -> questions (split_option)
+   * 3 -> answer (get index)
+   * 4 -> skipping a malformed record until the next separator
+   * reset to 0 once question ended
+   */
+  int line_type = 1;
+
+  // read by line
+  while (cursor < chunk->end) {
+    const char *newline = memchr(cursor, '\n', chunk->end - cursor);
+    const char *line = cursor;
+    size_t line_len = (newline != NULL ? newline : chunk->end) - cursor;
+    cursor = newline != NULL ? newline + 1 : chunk->end;
+
+    // return (separator line)
+    if (line_type == 0) {
+      // separator type (0)
+      if (line_len > 0) {
+        parse_error(chunk, line_num, "Expected separator line.");
+        line_type = 4;
+      } else {
+        line_type++;
+      }
+    }
+
+    // prompt type (1)
+    else if (line_type == 1) {
+      if (line_len < 2) {
+        parse_error(chunk, line_num,
+                    "Expected prompt string (recieved empty line).");
+        line_type = line_len == 0 ? 1 : 4;
+      } else {
+        this_entry = chunk_next_entry(chunk);
+        this_entry->prompt = arena_strndup(&chunk->strings, line, line_len);
+        chunk->lines[chunk->count] = line_num;
+        line_type++;
+      }
+    }
+
+    // options type (2)
+    else if (line_type == 2) {
+      if (line_len == 0) {
+        parse_error(chunk, line_num,
+                    "Expected option string (recieved empty line).");
+        line_type = 1;
+      } else if (split_option(&chunk->strings, this_entry->options, line,
+                              line_len, QUESTION_DELIM[0]) != 4) {
+        parse_error(chunk, line_num, "Invalid amount of options.");
+        line_type = 4;
+      } else {
+        line_type++;
+      }
+    }
+
+    // answer index type (3)
+    else if (line_type == 3) {
+      int set = 0;
+      for (int i = 0; i < 3; i++) {
+        if (strlen(this_entry->options[i]) == line_len &&
+            memcmp(line, this_entry->options[i], line_len) == 0) {
+          this_entry->answer_idx = i;
+          set = 1;
+        }
+      }
+
+      // error if supplied answer not in options
+      if (set != 1) {
+        parse_error(chunk, line_num,
+                    "Supplied answer not defined in options.");
+        line_type = line_len == 0 ? 1 : 4;
+      } else if (!entry_fits(this_entry)) {
+        parse_error(chunk, chunk->lines[chunk->count],
+                    "Question too long to send in one frame.");
+        line_type = 0;
+      } else {
+        chunk->count++;
+        line_type = 0;
+      }
+    }
+
+    // skip type (4)
+    else if (line_len == 0) {
+      line_type = 1;
+    }
+
+    line_num++;
+  }
+
+  chunk->num_lines = line_num - 1;
+  return NULL;
+}
+
+/**
+ * @brief Move a chunk's entries into the bank and encode their frames
+ * (thread entry point, runs once every chunk's base index is known)
+ * @param arg struct ChunkParse
+ * @return void*
+ */
+static void *encode_chunk(void *arg) {
+  struct ChunkParse *chunk = arg;
+  char frame[FRAME_HEADER + FRAME_MAX + 1];
+
+  int index = chunk->base;
+  for (int i = 0; i < chunk->count; i++) {
+    if (chunk->entries[i].prompt == NULL) {
+      continue; // duplicate
+    }
+    struct Entry *entry = &chunk->bank->entries[index];
+    *entry = chunk->entries[i];
+
+    int length = encode_question(frame, sizeof(frame), index, entry);
+    entry->question_frame = pin_frame(&chunk->arena, frame, length);
+    length = encode_answer(frame, sizeof(frame), entry);
+    entry->answer_frame = pin_frame(&chunk->arena, frame, length);
+    if (entry->question_frame == NULL || entry->answer_frame == NULL) {
+      fprintf(stderr, "Failed to allocate question frames.\n");
+      exit(1);
+    }
+    index++;
+  }
+  return NULL;
+}
+
+/**
+ * @brief Copy a parsed string into the bank's arena unless an equal one is
+ * already there
+ * @return const char* the bank's copy
+ */
+static const char *intern(struct QuestionBank *bank, struct StringTable *table,
+                          const char *str, size_t len, uint64_t hash) {
+  struct StringSlot *slot = strings_find(table, str, len, hash);
+  if (slot->str != NULL) {
+    bank->bytes_saved += len + 1;
+    return slot->str;
+  }
+  slot->str = arena_strndup(&bank->arena, str, len);
+  if (slot->str == NULL) {
+    fprintf(stderr, "Failed to allocate question storage.\n");
+    exit(1);
+  }
+  slot->hash = hash;
+  return slot->str;
+}
+
+/**
+ * @brief Intern every parsed string and drop exact duplicate questions
+ * walks the chunks in file order, so the first copy of a question is the
+ * one kept; each dropped copy is reported as a parse error. Entries are
+ * hashed by content (their strings and answer); once strings are interned
+ * two entries are equal exactly when they share every string pointer.
+ * @param bank
+ * @param chunks
+ * @param num_chunks
+ */
+static void dedup_chunks(struct QuestionBank *bank, struct ChunkParse *chunks,
+                         int num_chunks) {
+  size_t total = 0;
+  for (int i = 0; i < num_chunks; i++) {
+    total += chunks[i].count;
+  }
+  struct StringTable strings;
+  size_t entry_mask = 15;
+  while (entry_mask + 1 < total * 2) {
+    entry_mask = entry_mask * 2 + 1;
+  }
+  struct Entry **seen = calloc(entry_mask + 1, sizeof(struct Entry *));
+  uint64_t *seen_hash = calloc(entry_mask + 1, sizeof(uint64_t));
+  if (strings_init(&strings, total * 4) < 0 || seen == NULL ||
+      seen_hash == NULL) {
+    fprintf(stderr, "Failed to allocate question storage.\n");
+    exit(1);
+  }
+
+  // the tables are far larger than the caches: entries go through in
+  // batches whose slots are prefetched before any of them is probed
+  char frame[FRAME_HEADER + FRAME_MAX + 1];
+  size_t lens[DEDUP_BATCH][4];
+  uint64_t hashes[DEDUP_BATCH][4];
+  uint64_t entry_hashes[DEDUP_BATCH];
+  for (int c = 0; c < num_chunks; c++) {
+    struct ChunkParse *chunk = &chunks[c];
+    chunk->kept = 0;
+    for (int batch = 0; batch < chunk->count; batch += DEDUP_BATCH) {
+      int n = chunk->count - batch < DEDUP_BATCH ? chunk->count - batch
+                                                 : DEDUP_BATCH;
+      struct Entry *entries = &chunk->entries[batch];
+      for (int i = 0; i < n; i++) {
+        const char **strs = &entries[i].prompt; // prompt, options[3]
+        for (int s = 0; s < 4; s++) {
+          lens[i][s] = strlen(strs[s]);
+          hashes[i][s] = hash_bytes(strs[s], lens[i][s]);
+          __builtin_prefetch(&strings.slots[hashes[i][s] & strings.mask]);
+        }
+      }
+
+      for (int i = 0; i < n; i++) {
+        struct Entry *entry = &entries[i];
+        entry->prompt =
+            intern(bank, &strings, entry->prompt, lens[i][0], hashes[i][0]);
+        uint64_t hash = hash_combine(hashes[i][0], entry->answer_idx);
+        for (int o = 0; o < 3; o++) {
+          entry->options[o] = intern(bank, &strings, entry->options[o],
+                                     lens[i][o + 1], hashes[i][o + 1]);
+          hash = hash_combine(hash, hashes[i][o + 1]);
+        }
+        entry_hashes[i] = hash;
+        __builtin_prefetch(&seen[hash & entry_mask]);
+      }
+
+      for (int i = 0; i < n; i++) {
+        struct Entry *entry = &entries[i];
+        uint64_t hash = entry_hashes[i];
+        size_t slot = hash & entry_mask;
+        struct Entry *first;
+        while ((first = seen[slot]) != NULL &&
+               !(seen_hash[slot] == hash && first->prompt == entry->prompt &&
+                 first->answer_idx == entry->answer_idx &&
+                 memcmp(first->options, entry->options,
+                        sizeof(entry->options)) == 0)) {
+          slot = (slot + 1) & entry_mask;
+        }
+        if (first == NULL) {
+          seen[slot] = entry;
+          seen_hash[slot] = hash;
+          chunk->kept++;
+          continue;
+        }
+
+        // the copy would also have had its own entry and frames
+        bank->bytes_saved +=
+            sizeof(struct Entry) + 2 * sizeof(struct OutBuf) +
+            encode_question(frame, sizeof(frame), 0, entry) +
+            encode_answer(frame, sizeof(frame), entry);
+        bank->num_duplicates++;
+        parse_error(chunk, chunk->lines[batch + i],
+                    "Duplicate question, dropped.");
+        entry->prompt = NULL;
+      }
+    }
+  }
+
+  strings_free(&strings);
+  free(seen);
+  free(seen_hash);
+}
+
+static int compare_errors(const void *a, const void *b) {
+  return ((const struct ParseError *)a)->line -
+         ((const struct ParseError *)b)->line;
+}
+
+/**
+ * @brief Run fn over every chunk, one thread per chunk
+ * the calling thread takes the first chunk itself
+ */
+static void run_chunks(struct ChunkParse *chunks, int num_chunks,
+                       void *(*fn)(void *)) {
+  pthread_t *threads = calloc(num_chunks, sizeof(pthread_t));
+  int *started = calloc(num_chunks, sizeof(int));
+  for (int i = 1; i < num_chunks; i++) {
+    started[i] = pthread_create(&threads[i], NULL, fn, &chunks[i]) == 0;
+    if (!started[i]) {
+      fn(&chunks[i]);
+    }
+  }
+  fn(&chunks[0]);
+  for (int i = 1; i < num_chunks; i++) {
+    if (started[i]) {
+      pthread_join(threads[i], NULL);
+    }
+  }
+  free(started);
+  free(threads);
+}
+
+/**
+ * @brief read questions from question file into a bank
+ * the file is mapped and split at blank-line record boundaries into one
+ * chunk per thread; chunks are parsed in parallel and merged in file
+ * order. Strings are stored at their real length in the bank's arena,
+ * each distinct string once, and exact duplicate questions are dropped
+ * (bank->bytes_saved counts what both saved).
+ * Malformed records and duplicates are skipped and collected in
+ * bank->errors with their line numbers (see print_parse_errors).
+    destroy with bank_free
+ * @param bank
+ * @param filename
+ * @param num_threads
+ * @return int number of questions read, -1 if the file could not be read
+ */
+int read_questions(struct QuestionBank *bank, char *filename,
+                   int num_threads) {
+  memset(bank, 0, sizeof(*bank));
+  arena_init(&bank->arena);
+
+  // open question file
+  int fd = open(filename, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) < 0) {
+    fprintf(stderr, "Failed to read question file: %s\n", filename);
+    if (fd >= 0) {
+      close(fd);
+    }
+    arena_free(&bank->arena);
+    return -1;
+  }
+  size_t size = st.st_size;
+  if (size == 0) {
+    close(fd);
+    return 0;
+  }
+  const char *text = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (text == MAP_FAILED) {
+    fprintf(stderr, "Failed to read question file: %s\n", filename);
+    arena_free(&bank->arena);
+    return -1;
+  }
+  madvise((void *)text, size, MADV_SEQUENTIAL);
+
+  // split at record boundaries (just past a blank line)
+  if (num_threads < 1) {
+    num_threads = 1;
+  }
+  struct ChunkParse *chunks = calloc(num_threads, sizeof(struct ChunkParse));
+  const char *end = text + size;
+  const char *chunk_start = text;
+  for (int i = 0; i < num_threads; i++) {
+    const char *chunk_end = end;
+    if (i < num_threads - 1) {
+      const char *target = text + (size / num_threads) * (i + 1);
+      chunk_end = chunk_start > target ? chunk_start : target;
+      while (chunk_end < end - 1 &&
+             !(chunk_end[0] == '\n' && chunk_end[1] == '\n')) {
+        chunk_end++;
+      }
+      chunk_end = chunk_end < end - 1 ? chunk_end + 2 : end;
+    }
+    chunks[i].start = chunk_start;
+    chunks[i].end = chunk_end;
+    chunks[i].bank = bank;
+    arena_init(&chunks[i].arena);
+    arena_init(&chunks[i].strings);
+    chunk_start = chunk_end;
+  }
+
+  run_chunks(chunks, num_threads, parse_chunk);
+  dedup_chunks(bank, chunks, num_threads);
+
+  // assign each chunk its place in the merged bank
+  int first_line = 1;
+  for (int i = 0; i < num_threads; i++) {
+    chunks[i].base = bank->count;
+    bank->count += chunks[i].kept;
+    for (int e = 0; e < chunks[i].num_errors; e++) {
+      chunks[i].errors[e].line += first_line - 1;
+    }
+    bank->num_errors += chunks[i].num_errors;
+    first_line += chunks[i].num_lines;
+  }
+
+  bank->capacity = bank->count;
+  bank->entries =
+      malloc(sizeof(struct Entry) * (bank->count ? bank->count : 1));
+  bank->errors = malloc(sizeof(struct ParseError) *
+                        (bank->num_errors ? bank->num_errors : 1));
+  if (bank->entries == NULL || bank->errors == NULL) {
+    fprintf(stderr, "Failed to allocate question storage.\n");
+    exit(1);
+  }
+
+  // encode every question's wire frames once, up front
+  run_chunks(chunks, num_threads, encode_chunk);
+
+  // merge storage and errors in file order
+  int error_pos = 0;
+  for (int i = 0; i < num_threads; i++) {
+    arena_merge(&bank->arena, &chunks[i].arena);
+    memcpy(bank->errors + error_pos, chunks[i].errors,
+           sizeof(struct ParseError) * chunks[i].num_errors);
+    error_pos += chunks[i].num_errors;
+    arena_free(&chunks[i].strings);
+    free(chunks[i].entries);
+    free(chunks[i].lines);
+    free(chunks[i].errors);
+  }
+  free(chunks);
+  munmap((void *)text, size);
+
+  // duplicates were reported after each chunk's parse errors
+  if (bank->num_duplicates > 0) {
+    qsort(bank->errors, bank->num_errors, sizeof(struct ParseError),
+          compare_errors);
+  }
+
+  return bank->count;
+}
+
+/**
+ * @brief Print every parse error collected while reading a question file
+ * @param bank
+ * @param filename
+ */
+void print_parse_errors(struct QuestionBank *bank, char *filename) {
+  for (int i = 0; i < bank->num_errors; i++) {
+    fprintf(stderr, "Parsing error: %s(%d) ~ %s\n", filename,
+            bank->errors[i].line, bank->errors[i].reason);
+  }
+}
+
+void print_entry(struct Entry entry) {
+  printf("Prompt: %s\n", entry.prompt);
+  printf("Options: ");
+  for (int i = 0; i < 3; i++) {
+    printf("%s, ", entry.options[i]);
+  }
+  printf("\n");
+  printf("Correct answer: %d (%s)\n", entry.answer_idx,
+         entry.options[entry.answer_idx]);
+}
+
+/**
+ * @brief Bytes of memory a bank holds
+ * text banks count their arena and entry table, compiled banks their
+ * mapping (paged in lazily by the kernel)
+ * @param bank
+ * @return size_t
+ */
+size_t bank_memory(struct QuestionBank *bank) {
+  if (bank->map != NULL) {
+    return bank->map_size;
+  }
+  return bank->arena.reserved + sizeof(struct Entry) * bank->capacity;
+}
+
+/**
+ * @brief returns if file starts with the compiled bank magic
+ * returns 1 if so, 0 else
+ * @param filename
+ * @return int
+ */
+int bank_is_compiled(char *filename) {
+  char magic[sizeof(BANK_MAGIC) - 1];
+  FILE *fp = fopen(filename, "rb");
+  if (fp == NULL) {
+    return 0;
+  }
+  size_t n = fread(magic, 1, sizeof(magic), fp);
+  fclose(fp);
+  return n == sizeof(magic) && memcmp(magic, BANK_MAGIC, sizeof(magic)) == 0;
+}
+
+/**
+ * @brief Check that a frame image lies whole within the frames section
+ * and is pinned, so sending it never counts or frees mapped memory
+ * @param frames start of the frames section
+ * @param frames_size
+ * @param offset the frame's offset in the section
+ * @return int 1 if the frame can be served as is
+ */
+static int frame_valid(const char *frames, uint64_t frames_size,
+                       uint64_t offset) {
+  if (frames_size < sizeof(struct OutBuf) ||
+      offset > frames_size - sizeof(struct OutBuf) ||
+      offset % sizeof(size_t) != 0) {
+    return 0;
+  }
+  const struct OutBuf *frame = (const struct OutBuf *)(frames + offset);
+  return frame->refs == OUTBUF_PINNED &&
+         frame->length <= frames_size - offset - sizeof(struct OutBuf);
+}
+
+/**
+ * @brief Map a compiled bank into memory
+ * only the header, record table and frame headers are checked; strings
+ * are not touched, so the bank is ready to serve as soon as the map exists
+ * @param bank
+ * @param filename
+ * @return int 0 on success, -1 on failure (reason printed)
+ */
+int bank_map(struct QuestionBank *bank, char *filename) {
+  memset(bank, 0, sizeof(*bank));
+
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    perror(filename);
+    return -1;
+  }
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    perror(filename);
+    close(fd);
+    return -1;
+  }
+  size_t size = st.st_size;
+  if (size < sizeof(struct BankHeader)) {
+    fprintf(stderr, "Bank error: %s ~ file too small.\n", filename);
+    close(fd);
+    return -1;
+  }
+
+  void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    perror("mmap");
+    return -1;
+  }
+
+  const struct BankHeader *header = map;
+  const char *reason = NULL;
+  if (memcmp(header->magic, BANK_MAGIC, sizeof(header->magic)) != 0) {
+    reason = "bad magic.";
+  } else if (header->version != BANK_VERSION) {
+    reason = "unsupported version.";
+  } else if (header->records_offset > size ||
+             (size - header->records_offset) / sizeof(struct BankRecord) <
+                 header->count) {
+    reason = "record table out of bounds.";
+  } else if (header->pool_offset > size || header->pool_size == 0 ||
+             header->pool_size > size - header->pool_offset) {
+    reason = "string pool out of bounds.";
+  } else if (((const char *)map)[header->pool_offset + header->pool_size -
+                                  1] != '\0') {
+    reason = "string pool not terminated.";
+  } else if (header->frames_offset > size ||
+             header->frames_size > size - header->frames_offset ||
+             header->frames_offset % sizeof(size_t) != 0) {
+    reason = "frames out of bounds.";
+  }
+
+  const struct BankRecord *records =
+      (const struct BankRecord *)((const char *)map + header->records_offset);
+  const char *frames = (const char *)map + header->frames_offset;
+  for (uint32_t i = 0; reason == NULL && i < header->count; i++) {
+    const struct BankRecord *record = &records[i];
+    if (record->prompt >= header->pool_size ||
+        record->options[0] >= header->pool_size ||
+        record->options[1] >= header->pool_size ||
+        record->options[2] >= header->pool_size || record->answer_idx > 2) {
+      reason = "corrupt record.";
+    }
+    if (!frame_valid(frames, header->frames_size, record->question_frame) ||
+        !frame_valid(frames, header->frames_size, record->answer_frame)) {
+      reason = "corrupt frame.";
+    }
+  }
+
+  if (reason != NULL) {
+    fprintf(stderr, "Bank error: %s ~ %s\n", filename, reason);
+    munmap(map, size);
+    return -1;
+  }
+
+  bank->count = header->count;
+  bank->map = map;
+  bank->map_size = size;
+  bank->records = records;
+  bank->pool = (const char *)map + header->pool_offset;
+  bank->frames = frames;
+  return 0;
+}
+
+/**
+ * @brief Write a bank out in the compiled format
+ * written to a temporary file and renamed, so a running server never maps
+ * a half written bank
+ * @param bank
+ * @param filename
+ * @return int 0 on success, -1 on failure (reason printed)
+ */
+int bank_compile(struct QuestionBank *bank, char *filename) {
+  struct BankRecord *records = calloc(bank->count ? bank->count : 1,
+                                      sizeof(struct BankRecord));
+  struct Buffer pool = {NULL, 0, 0};
+  struct Buffer frames = {NULL, 0, 0};
+  char frame[FRAME_HEADER + FRAME_MAX + 1];
+  struct StringTable pooled = {NULL, 0};
+  int ok = records != NULL && strings_init(&pooled, bank->count * 4) == 0;
+
+  // build record table, string pool (each distinct string once) and
+  // pinned frames
+  struct Entry entry;
+  for (int i = 0; ok && i < bank->count; i++) {
+    bank_get(bank, i, &entry);
+    const char *strings[4] = {entry.prompt, entry.options[0],
+                              entry.options[1], entry.options[2]};
+    uint32_t offsets[4];
+    for (int s = 0; ok && s < 4; s++) {
+      size_t len = strlen(strings[s]);
+      uint64_t hash = hash_bytes(strings[s], len);
+      struct StringSlot *slot = strings_find(&pooled, strings[s], len, hash);
+      if (slot->str == NULL) {
+        slot->str = strings[s];
+        slot->hash = hash;
+        slot->value = pool.size;
+        ok = buffer_append(&pool, strings[s], len + 1) == 0;
+      }
+      offsets[s] = slot->value;
+    }
+
+    int lengths[2] = {encode_question(frame, sizeof(frame), i, &entry), 0};
+    uint64_t frame_offsets[2];
+    for (int f = 0; ok && f < 2; f++) {
+      if (f == 1) {
+        lengths[1] = encode_answer(frame, sizeof(frame), &entry);
+      }
+      // keep every OutBuf image aligned like a malloc'd one
+      static const char padding[sizeof(size_t)];
+      size_t pad = (sizeof(size_t) - frames.size % sizeof(size_t)) %
+                   sizeof(size_t);
+      struct OutBuf image = {OUTBUF_PINNED, lengths[f]};
+      ok = buffer_append(&frames, padding, pad) == 0;
+      frame_offsets[f] = frames.size;
+      ok = ok && buffer_append(&frames, &image, sizeof(image)) == 0 &&
+           buffer_append(&frames, frame, lengths[f]) == 0;
+    }
+    if (!ok) {
+      break;
+    }
+
+    records[i].prompt = offsets[0];
+    records[i].options[0] = offsets[1];
+    records[i].options[1] = offsets[2];
+    records[i].options[2] = offsets[3];
+    records[i].answer_idx = entry.answer_idx;
+    records[i].question_frame = frame_offsets[0];
+    records[i].answer_frame = frame_offsets[1];
+  }
+  if (ok && pool.size == 0) {
+    ok = buffer_append(&pool, "", 1) == 0;
+  }
+  strings_free(&pooled);
+  if (!ok) {
+    free(records);
+    free(pool.data);
+    free(frames.data);
+    fprintf(stderr, "Bank error: %s ~ out of memory.\n", filename);
+    return -1;
+  }
+
+  struct BankHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, BANK_MAGIC, sizeof(header.magic));
+  header.version = BANK_VERSION;
+  header.count = bank->count;
+  header.records_offset = sizeof(header);
+  header.pool_offset =
+      header.records_offset + sizeof(struct BankRecord) * bank->count;
+  header.pool_size = pool.size;
+  header.frames_offset = (header.pool_offset + pool.size + sizeof(size_t) - 1) &
+                         ~(uint64_t)(sizeof(size_t) - 1);
+  header.frames_size = frames.size;
+
+  char tmp_name[4096];
+  snprintf(tmp_name, sizeof(tmp_name), "%s.tmp", filename);
+  FILE *fp = fopen(tmp_name, "wb");
+  ok = fp != NULL;
+  if (ok) {
+    static const char padding[sizeof(size_t)];
+    size_t pad = header.frames_offset - header.pool_offset - pool.size;
+    ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+         fwrite(records, sizeof(struct BankRecord), bank->count, fp) ==
+             (size_t)bank->count &&
+         fwrite(pool.data, 1, pool.size, fp) == pool.size &&
+         fwrite(padding, 1, pad, fp) == pad &&
+         fwrite(frames.data, 1, frames.size, fp) == frames.size;
+    ok = fclose(fp) == 0 && ok;
+  }
+  if (ok) {
+    ok = rename(tmp_name, filename) == 0;
+  }
+  if (!ok) {
+    perror(filename);
+    unlink(tmp_name);
+  }
+
+  free(records);
+  free(pool.data);
+  free(frames.data);
+  return ok ? 0 : -1;
+}
+
+/**
+ * @brief Copy question `index` of a bank into dest
+ * @param bank
+ * @param index
+ * @param dest
+ */
+void bank_get(struct QuestionBank *bank, int index, struct Entry *dest) {
+  if (bank->entries != NULL) {
+    *dest = bank->entries[index];
+    return;
+  }
+
+  const struct BankRecord *record = &bank->records[index];
+  dest->prompt = bank->pool + record->prompt;
+  for (int i = 0; i < 3; i++) {
+    dest->options[i] = bank->pool + record->options[i];
+  }
+  dest->answer_idx = record->answer_idx;
+  dest->question_frame = bank_question_frame(bank, index);
+  dest->answer_frame = bank_answer_frame(bank, index);
+}
+
+int bank_answer(struct QuestionBank *bank, int index) {
+  if (bank->entries != NULL) {
+    return bank->entries[index].answer_idx;
+  }
+  return bank->records[index].answer_idx;
+}
+
+/**
+ * @brief Pre-encoded QUESTION_SEND frame for question `index`
+ * the frame is pinned: queue it as-is, never free it
+ */
+struct OutBuf *bank_question_frame(struct QuestionBank *bank, int index) {
+  if (bank->entries != NULL) {
+    return bank->entries[index].question_frame;
+  }
+  return (struct OutBuf *)(bank->frames + bank->records[index].question_frame);
+}
+
+/**
+ * @brief Pre-encoded ANSWER_BROADCAST frame for question `index`
+ * the frame is pinned: queue it as-is, never free it
+ */
+struct OutBuf *bank_answer_frame(struct QuestionBank *bank, int index) {
+  if (bank->entries != NULL) {
+    return bank->entries[index].answer_frame;
+  }
+  return (struct OutBuf *)(bank->frames + bank->records[index].answer_frame);
+}
+
+/**
+ * @brief Release a bank's mapping or text storage
+ * @param bank
+ */
+void bank_free(struct QuestionBank *bank) {
+  if (bank->map != NULL) {
+    munmap(bank->map, bank->map_size);
+  }
+  free(bank->entries);
+  free(bank->errors);
+  arena_free(&bank->arena);
+  memset(bank, 0, sizeof(*bank));
+}
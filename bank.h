@@ -0,0 +1,105 @@
+/**
+  Question banks
+
+  A bank is either parsed from the text question format or mapped straight
+  from a compiled binary bank (see bank_compile). Rooms only read banks
+  through bank_get, so they do not care which one they were given.
+*/
+
+#ifndef BANK_H
+#define BANK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "proto.h"
+
+/**
+  One question. Strings point into the owning bank (its arena or its
+  mapped string pool) and are NUL terminated. The QUESTION_SEND and
+  ANSWER_BROADCAST frames are encoded once when the bank is loaded (or
+  compiled) and are pinned for the bank's lifetime.
+ */
+struct Entry {
+  const char *prompt;
+  const char *options[3];
+  int answer_idx;
+  struct OutBuf *question_frame;
+  struct OutBuf *answer_frame;
+};
+
+/**
+  Compiled bank layout (host byte order):
+  header | BankRecord[count] | string pool | frames
+  Record strings are offsets into the pool and are NUL terminated there.
+  Record frames are offsets into the frames section, which holds pinned
+  struct OutBuf images ready to be queued straight from the mapping.
+ */
+#define BANK_MAGIC "TRIVBANK"
+#define BANK_VERSION 2
+
+struct BankHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t count;
+  uint64_t records_offset;
+  uint64_t pool_offset;
+  uint64_t pool_size;
+  uint64_t frames_offset;
+  uint64_t frames_size;
+};
+
+struct BankRecord {
+  uint32_t prompt;
+  uint32_t options[3];
+  uint32_t answer_idx;
+  uint32_t reserved;
+  uint64_t question_frame;
+  uint64_t answer_frame;
+};
+
+/**
+  Malformed record found while reading a text question file
+ */
+struct ParseError {
+  int line;
+  const char *reason;
+};
+
+struct QuestionBank {
+  int count;
+  // text banks
+  struct Entry *entries;
+  int capacity;
+  struct Arena arena;
+  struct ParseError *errors;
+  int num_errors;
+  int num_duplicates; // of num_errors, questions dropped as exact copies
+  size_t bytes_saved; // by interning strings and dropping duplicates
+  // compiled banks
+  void *map;
+  size_t map_size;
+  const struct BankRecord *records;
+  const char *pool;
+  const char *frames;
+  // rooms and workers still using the bank (server, atomic)
+  int refs;
+};
+
+int read_questions(struct QuestionBank *bank, char *filename,
+                   int num_threads);
+void print_parse_errors(struct QuestionBank *bank, char *filename);
+void print_entry(struct Entry entry);
+size_t bank_memory(struct QuestionBank *bank);
+
+int bank_is_compiled(char *filename);
+int bank_map(struct QuestionBank *bank, char *filename);
+int bank_compile(struct QuestionBank *bank, char *filename);
+void bank_get(struct QuestionBank *bank, int index, struct Entry *dest);
+int bank_answer(struct QuestionBank *bank, int index);
+struct OutBuf *bank_question_frame(struct QuestionBank *bank, int index);
+struct OutBuf *bank_answer_frame(struct QuestionBank *bank, int index);
+void bank_free(struct QuestionBank *bank);
+
+#endif
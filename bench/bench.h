@@ -0,0 +1,31 @@
+/**
+  Machine-readable benchmark results
+
+  When BENCH_RESULTS names a file, every result is also appended to it as
+  a CSV row: build,benchmark,case,metric,value. BENCH_BUILD labels the
+  build (make bench uses the git revision) so runs can be compared.
+*/
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static inline void bench_result(const char *benchmark, const char *name,
+                                const char *metric, double value) {
+  char *path = getenv("BENCH_RESULTS");
+  if (path == NULL || path[0] == 0) {
+    return;
+  }
+  FILE *file = fopen(path, "a");
+  if (file == NULL) {
+    return;
+  }
+  char *build = getenv("BENCH_BUILD");
+  fprintf(file, "%s,%s,%s,%s,%.3f\n", build != NULL ? build : "", benchmark,
+          name, metric, value);
+  fclose(file);
+}
+
+#endif
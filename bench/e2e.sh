@@ -0,0 +1,21 @@
+#!/bin/sh
+# End-to-end loopback benchmark
+# starts a server, plays full games against it with bots that answer
+# immediately and reports game rounds per second
+# usage: bench/e2e.sh [bots] [seconds]
+# E2E_SERVER_FLAGS is passed to the server (e.g. -u for the io_uring loop)
+BOTS=${1:-30}
+DURATION=${2:-5}
+PORT=${E2E_PORT:-26555}
+QUESTIONS=questions.txt
+
+./server -p "$PORT" -f "$QUESTIONS" $E2E_SERVER_FLAGS > /dev/null &
+SERVER=$!
+sleep 0.5
+
+./bot -p "$PORT" -n "$BOTS" -d "$DURATION" -l 0 -f "$QUESTIONS"
+STATUS=$?
+
+kill "$SERVER"
+wait "$SERVER" 2> /dev/null
+exit $STATUS
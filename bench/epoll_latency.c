@@ -0,0 +1,188 @@
+/**
+  Wakeup-to-dispatch latency benchmark
+  compares the old select() + linear scan loop against edge-triggered epoll
+  as the number of idle connections grows
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+/**
+ * DEFINE CONSTANTS
+ */
+const int ROUNDS = 2000;
+const int MAX_EVENTS = 1024;
+int CONNECTION_COUNTS[] = {16, 128, 1000, 4000, 8000, 25000, 50000, 0};
+
+struct Conn {
+  int fd;   // "server" side, watched by the loop
+  int peer; // "client" side, written to wake the loop
+};
+
+void failwith(char *message) {
+  fprintf(stderr, "Error: %s\n", message);
+  exit(1);
+}
+
+long long now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int cmp_ll(const void *a, const void *b) {
+  long long x = *(const long long *)a;
+  long long y = *(const long long *)b;
+  return (x > y) - (x < y);
+}
+
+/**
+ * @brief Report median / p99 of samples in microseconds
+ */
+void report(char *loop, int conns, long long *samples, int n) {
+  qsort(samples, n, sizeof(long long), cmp_ll);
+  double p50 = samples[n / 2] / 1000.0;
+  double p99 = samples[(n * 99) / 100] / 1000.0;
+  printf("%-7s %8d %10.2f %10.2f\n", loop, conns, p50, p99);
+
+  char name[64];
+  snprintf(name, sizeof(name), "%s_%d", loop, conns);
+  bench_result("epoll_latency", name, "p50_us", p50);
+  bench_result("epoll_latency", name, "p99_us", p99);
+}
+
+/**
+ * @brief Time from a peer write to the loop reaching the ready fd
+ * the select loop mirrors the original client_handler: FD_ZERO/FD_SET every
+ * iteration, then scan all connections for the ready one
+ */
+void bench_select(struct Conn *conns, int n, long long *samples) {
+  fd_set readfds;
+  char byte;
+
+  for (int r = 0; r < ROUNDS; r++) {
+    struct Conn *target = &conns[rand() % n];
+    long long start = now_ns();
+    write(target->peer, "x", 1);
+
+    FD_ZERO(&readfds);
+    int max_fd = 0;
+    for (int i = 0; i < n; i++) {
+      FD_SET(conns[i].fd, &readfds);
+      if (conns[i].fd > max_fd) {
+        max_fd = conns[i].fd;
+      }
+    }
+    if (select(max_fd + 1, &readfds, NULL, NULL, NULL) < 1) {
+      failwith("select failed");
+    }
+
+    struct Conn *ready = NULL;
+    for (int i = 0; i < n; i++) {
+      if (FD_ISSET(conns[i].fd, &readfds)) {
+        ready = &conns[i];
+      }
+    }
+    samples[r] = now_ns() - start;
+    read(ready->fd, &byte, 1);
+  }
+}
+
+void bench_epoll(struct Conn *conns, int n, long long *samples) {
+  int epoll_fd = epoll_create1(0);
+  struct epoll_event events[MAX_EVENTS];
+  char byte;
+
+  for (int i = 0; i < n; i++) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = &conns[i];
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, conns[i].fd, &ev) < 0) {
+      failwith("epoll_ctl failed");
+    }
+  }
+
+  for (int r = 0; r < ROUNDS; r++) {
+    struct Conn *target = &conns[rand() % n];
+    long long start = now_ns();
+    write(target->peer, "x", 1);
+
+    int ready = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+    if (ready < 1) {
+      failwith("epoll_wait failed");
+    }
+    struct Conn *conn = events[0].data.ptr;
+    samples[r] = now_ns() - start;
+    // drain until EAGAIN as the server does
+    while (recv(conn->fd, &byte, 1, MSG_DONTWAIT) > 0) {
+    }
+  }
+
+  close(epoll_fd);
+}
+
+int main(int argc, char **argv) {
+  // each connection is a socketpair (2 fds), raise the limit as high as allowed
+  struct rlimit limit;
+  getrlimit(RLIMIT_NOFILE, &limit);
+  limit.rlim_cur = limit.rlim_max;
+  setrlimit(RLIMIT_NOFILE, &limit);
+  int max_conns = (int)((limit.rlim_cur - 16) / 2);
+
+  long long *samples = malloc(sizeof(long long) * ROUNDS);
+  printf("%-7s %8s %10s %10s\n", "loop", "conns", "p50_us", "p99_us");
+
+  for (int c = 0; CONNECTION_COUNTS[c] != 0; c++) {
+    int n = CONNECTION_COUNTS[c];
+    if (n > max_conns) {
+      printf("# skipping %d connections (fd limit %llu)\n", n,
+             (unsigned long long)limit.rlim_cur);
+      continue;
+    }
+
+    struct Conn *conns = malloc(sizeof(struct Conn) * n);
+    for (int i = 0; i < n; i++) {
+      int pair[2];
+      if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) < 0) {
+        failwith(strerror(errno));
+      }
+      conns[i].fd = pair[0];
+      conns[i].peer = pair[1];
+    }
+
+    // select cannot watch fds past FD_SETSIZE at all
+    int highest = 0;
+    for (int i = 0; i < n; i++) {
+      highest = conns[i].fd > highest ? conns[i].fd : highest;
+    }
+    if (highest < FD_SETSIZE) {
+      bench_select(conns, n, samples);
+      report("select", n, samples, ROUNDS);
+    } else {
+      printf("%-7s %8d %10s %10s\n", "select", n, "n/a", "n/a");
+    }
+
+    bench_epoll(conns, n, samples);
+    report("epoll", n, samples, ROUNDS);
+
+    for (int i = 0; i < n; i++) {
+      close(conns[i].fd);
+      close(conns[i].peer);
+    }
+    free(conns);
+  }
+
+  free(samples);
+  return 0;
+}
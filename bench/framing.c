@@ -0,0 +1,148 @@
+/**
+  Framing and broadcast microbenchmark
+  times the per-message hot paths between the parser and the socket:
+  split_option on a question's option line, frame_printf + swrite of a
+  reply, and a room broadcast (encode once, queue a reference per player,
+  one sendmsg each) with a freshly allocated and with a pinned frame
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../arena.h"
+#include "../proto.h"
+#include "bench.h"
+
+/**
+ * DEFINE CONSTANTS
+ */
+const int ITERATIONS = 200000;
+#define ROOM_SIZE 3
+// peers are drained this often so socket buffers never fill
+const int DRAIN_EVERY = 256;
+
+char *OPTION_LINE = "Aquarius Cancer Pisces";
+char *QUESTION =
+    "Who sang the title song for the latest Bond film, No Time to Die?";
+
+// defined in bank.c
+int split_option(struct Arena *arena, const char *dest[3], const char *str,
+                 size_t len, char delim);
+
+// sink so the compiler cannot drop the work
+volatile size_t Sink;
+
+int Fds[ROOM_SIZE];
+int Peers[ROOM_SIZE];
+struct OutQueue Queues[ROOM_SIZE];
+struct Arena Scratch;
+struct OutBuf *Pinned;
+
+void failwith(char *message) {
+  fprintf(stderr, "Error: %s\n", message);
+  exit(1);
+}
+
+long long now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void drain_peers() {
+  char buffer[64 * 1024];
+  for (int i = 0; i < ROOM_SIZE; i++) {
+    while (recv(Peers[i], buffer, sizeof(buffer), MSG_DONTWAIT) > 0) {
+    }
+  }
+}
+
+void run_split_option(int i) {
+  const char *options[3];
+  if (i % 4096 == 0) {
+    arena_free(&Scratch);
+  }
+  Sink += split_option(&Scratch, options, OPTION_LINE, strlen(OPTION_LINE),
+                       ' ');
+}
+
+void run_swrite(int i) {
+  char frame[256];
+  int length = frame_printf(frame, sizeof(frame), "%d|%d", 4, i % 3 + 1);
+  Sink += swrite(Fds[0], frame, length);
+}
+
+void queue_to_room(struct OutBuf *frame) {
+  for (int p = 0; p < ROOM_SIZE; p++) {
+    if (outq_push(&Queues[p], frame) < 0) {
+      failwith("outq_push failed");
+    }
+    Sink += outq_flush(&Queues[p], Fds[p]);
+  }
+}
+
+void run_broadcast(int i) {
+  struct OutBuf *frame = outbuf_printf("%d|%d|%s|%s|%s|%s", 3, i, QUESTION,
+                                       "Adele", "Sam_Smith", "Billie_Eilish");
+  queue_to_room(frame);
+  outbuf_release(frame);
+}
+
+void run_broadcast_pinned(int i) { queue_to_room(Pinned); }
+
+void measure(char *name, void (*run)(int)) {
+  long long start = now_ns();
+  for (int i = 0; i < ITERATIONS; i++) {
+    run(i);
+    if (i % DRAIN_EVERY == DRAIN_EVERY - 1) {
+      drain_peers();
+    }
+  }
+  long long elapsed = now_ns() - start;
+  drain_peers();
+
+  double per_sec = ITERATIONS / (elapsed / 1e9);
+  double ns_per_op = (double)elapsed / ITERATIONS;
+  printf("%-18s %14.0f %10.1f\n", name, per_sec, ns_per_op);
+  bench_result("framing", name, "ops_per_sec", per_sec);
+  bench_result("framing", name, "ns_per_op", ns_per_op);
+}
+
+int main(int argc, char **argv) {
+  for (int i = 0; i < ROOM_SIZE; i++) {
+    int pair[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) < 0) {
+      failwith(strerror(errno));
+    }
+    Fds[i] = pair[0];
+    Peers[i] = pair[1];
+    outq_init(&Queues[i]);
+  }
+  arena_init(&Scratch);
+
+  // a bank-owned frame: never counted or freed
+  struct OutBuf *frame = outbuf_printf("%d|%d|%s|%s|%s|%s", 3, 0, QUESTION,
+                                       "Adele", "Sam_Smith", "Billie_Eilish");
+  frame->refs = OUTBUF_PINNED;
+  Pinned = frame;
+
+  printf("%-18s %14s %10s\n", "path", "ops_per_sec", "ns_per_op");
+  measure("split_option", run_split_option);
+  measure("swrite", run_swrite);
+  measure("broadcast", run_broadcast);
+  measure("broadcast_pinned", run_broadcast_pinned);
+
+  for (int i = 0; i < ROOM_SIZE; i++) {
+    outq_clear(&Queues[i]);
+    close(Fds[i]);
+    close(Peers[i]);
+  }
+  free(frame);
+  arena_free(&Scratch);
+  return 0;
+}
@@ -0,0 +1,141 @@
+/**
+  Journal benchmark
+  worker threads append answer records the way the server does, once with
+  group commit at a few intervals and once with a write and fdatasync per
+  record (what journaling on the answer path would cost). Reports the
+  append cost seen by the workers and how many records each sync covered.
+  The journal is written under BENCH_JOURNAL_DIR (default: the current
+  directory), sync cost depends on the filesystem behind it.
+*/
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../journal.h"
+#include "bench.h"
+
+/**
+ * DEFINE CONSTANTS
+ */
+const int THREADS = 4;
+const int RECORDS = 20000; // per thread
+const int SYNC_RECORDS = 500; // per thread, syncing every record is slow
+long long INTERVALS_MS[] = {0, 1, 10, -1};
+
+struct Run {
+  struct Journal *journal;
+  int fd; // sync-per-record mode when journal is NULL
+  int records;
+  long long ns;
+};
+
+pthread_mutex_t SyncLock = PTHREAD_MUTEX_INITIALIZER;
+
+void failwith(char *message) {
+  fprintf(stderr, "Error: %s\n", message);
+  exit(1);
+}
+
+long long now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void *appender(void *arg) {
+  struct Run *run = arg;
+  struct JournalRecord record;
+  long long start = now_ns();
+  for (int i = 0; i < run->records; i++) {
+    memset(&record, 0, sizeof(record));
+    record.type = JOURNAL_ANSWER;
+    record.room = i / 24;
+    record.seat = i % 3;
+    record.question = i % 24;
+    record.choice = 1 + i % 3;
+    record.delta = i % 2 ? 1 : -1;
+    if (run->journal != NULL) {
+      journal_append(run->journal, &record, NULL, 0);
+    } else {
+      record.size = sizeof(record);
+      pthread_mutex_lock(&SyncLock);
+      if (write(run->fd, &record, sizeof(record)) != sizeof(record) ||
+          fdatasync(run->fd) < 0) {
+        failwith("journal write failed");
+      }
+      pthread_mutex_unlock(&SyncLock);
+    }
+  }
+  run->ns = now_ns() - start;
+  return NULL;
+}
+
+/**
+ * @brief Run THREADS appenders
+ * @return double mean ns per append
+ */
+double run_appenders(struct Journal *journal, int fd, int records) {
+  pthread_t threads[THREADS];
+  struct Run runs[THREADS];
+  for (int t = 0; t < THREADS; t++) {
+    runs[t] = (struct Run){journal, fd, records, 0};
+    pthread_create(&threads[t], NULL, appender, &runs[t]);
+  }
+  long long ns = 0;
+  for (int t = 0; t < THREADS; t++) {
+    pthread_join(threads[t], NULL);
+    ns += runs[t].ns;
+  }
+  return (double)ns / ((double)THREADS * records);
+}
+
+void report(char *name, double append_ns, double per_sync) {
+  printf("%-14s %14.1f %16.1f\n", name, append_ns, per_sync);
+  bench_result("journal", name, "append_ns", append_ns);
+  bench_result("journal", name, "records_per_sync", per_sync);
+}
+
+int main(int argc, char **argv) {
+  char *dir = getenv("BENCH_JOURNAL_DIR");
+  char path[1024];
+  snprintf(path, sizeof(path), "%s/bench_journal.XXXXXX",
+           dir != NULL ? dir : ".");
+  int tmp = mkstemp(path);
+  if (tmp < 0) {
+    failwith("Could not create the benchmark journal");
+  }
+  close(tmp);
+
+  printf("%-14s %14s %16s\n", "mode", "append_ns", "records_per_sync");
+  for (int i = 0; INTERVALS_MS[i] >= 0; i++) {
+    unlink(path);
+    struct Journal journal;
+    if (journal_open(&journal, path, INTERVALS_MS[i], 1 << 20) < 0) {
+      failwith("Could not open the benchmark journal");
+    }
+    double append_ns = run_appenders(&journal, -1, RECORDS);
+    journal_close(&journal);
+
+    char name[32];
+    snprintf(name, sizeof(name), "group_%lldms", INTERVALS_MS[i]);
+    report(name, append_ns,
+           (double)journal.records / (journal.commits > 0 ? journal.commits
+                                                          : 1));
+  }
+
+  unlink(path);
+  int fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+  if (fd < 0) {
+    failwith("Could not open the benchmark journal");
+  }
+  report("sync_each", run_appenders(NULL, fd, SYNC_RECORDS), 1);
+  close(fd);
+  unlink(path);
+  return 0;
+}
@@ -0,0 +1,110 @@
+/**
+  Leaderboard benchmark
+  plays questions for rooms of up to 100k players: every player's score
+  changes by +-1, then each player's rank and the top 10 are read, as the
+  server does after every question. Compared against re-sorting the room.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../leaderboard.h"
+#include "bench.h"
+
+/**
+ * DEFINE CONSTANTS
+ */
+int PLAYER_COUNTS[] = {100, 1000, 10000, 100000, 0};
+const int QUESTIONS = 20;
+const int TOP_K = 10;
+
+// sink so the compiler cannot drop the work
+volatile long Sink;
+
+long long now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int *SortScores;
+
+int cmp_score(const void *a, const void *b) {
+  return SortScores[*(const int *)b] - SortScores[*(const int *)a];
+}
+
+/**
+ * @brief ns per player per question with the leaderboard
+ */
+double run_board(int n) {
+  struct Leaderboard board;
+  leaderboard_init(&board, n);
+  for (int i = 0; i < n; i++) {
+    leaderboard_add(&board, i);
+  }
+  int top[TOP_K];
+
+  srand(1);
+  long long start = now_ns();
+  for (int q = 0; q < QUESTIONS; q++) {
+    for (int i = 0; i < n; i++) {
+      leaderboard_update(&board, i, rand() % 2 ? 1 : -1);
+    }
+    for (int i = 0; i < n; i++) {
+      Sink += leaderboard_rank(&board, i);
+    }
+    Sink += leaderboard_top(&board, TOP_K, top);
+  }
+  long long elapsed = now_ns() - start;
+  leaderboard_free(&board);
+  return (double)elapsed / QUESTIONS / n;
+}
+
+/**
+ * @brief ns per player per question sorting the room after each question
+ */
+double run_sort(int n) {
+  int *scores = calloc(n, sizeof(int));
+  int *order = malloc(sizeof(int) * n);
+  int *rank = malloc(sizeof(int) * n);
+  SortScores = scores;
+
+  srand(1);
+  long long start = now_ns();
+  for (int q = 0; q < QUESTIONS; q++) {
+    for (int i = 0; i < n; i++) {
+      scores[i] += rand() % 2 ? 1 : -1;
+      order[i] = i;
+    }
+    qsort(order, n, sizeof(int), cmp_score);
+    for (int i = 0; i < n; i++) {
+      rank[order[i]] = i;
+    }
+    for (int i = 0; i < n; i++) {
+      Sink += rank[i];
+    }
+    Sink += order[0];
+  }
+  long long elapsed = now_ns() - start;
+  free(scores);
+  free(order);
+  free(rank);
+  return (double)elapsed / QUESTIONS / n;
+}
+
+int main(int argc, char **argv) {
+  printf("%-8s %14s %14s\n", "players", "board_ns", "sort_ns");
+  for (int c = 0; PLAYER_COUNTS[c] != 0; c++) {
+    int n = PLAYER_COUNTS[c];
+    double board_ns = run_board(n);
+    double sort_ns = run_sort(n);
+    printf("%-8d %14.1f %14.1f\n", n, board_ns, sort_ns);
+
+    char name[32];
+    snprintf(name, sizeof(name), "players_%d", n);
+    bench_result("leaderboard", name, "board_ns_per_player", board_ns);
+    bench_result("leaderboard", name, "sort_ns_per_player", sort_ns);
+  }
+  return 0;
+}
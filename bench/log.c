@@ -0,0 +1,127 @@
+/**
+  Logging benchmark
+  worker threads log game-event lines the way the server does, once
+  through the asynchronous log and once with a synchronous write per line,
+  into a pipe whose reader keeps up and then stalls for a while (a slow
+  terminal). Reports the cost of a log call seen by the workers and the
+  worst single call; the asynchronous log drops what its rings cannot
+  hold during the stall.
+*/
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../log.h"
+#include "bench.h"
+
+/**
+ * DEFINE CONSTANTS
+ */
+const int THREADS = 4;
+const int LINES = 20000; // per thread
+const int STALL_MS = 200;
+
+struct Run {
+  int sync_fd; // synchronous mode when >= 0
+  long long ns;
+  long long worst_ns;
+};
+
+int Stall; // atomic, the reader pauses STALL_MS once when set
+
+void failwith(char *message) {
+  fprintf(stderr, "Error: %s\n", message);
+  exit(1);
+}
+
+long long now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void *reader(void *arg) {
+  int fd = *(int *)arg;
+  struct timespec stall = {0, STALL_MS * 1000000L};
+  char buf[65536];
+  while (read(fd, buf, sizeof(buf)) > 0) {
+    if (__atomic_exchange_n(&Stall, 0, __ATOMIC_ACQ_REL)) {
+      nanosleep(&stall, NULL);
+    }
+  }
+  return NULL;
+}
+
+void *logger(void *arg) {
+  struct Run *run = arg;
+  long long start = now_ns();
+  for (int i = 0; i < LINES; i++) {
+    long long call = now_ns();
+    if (run->sync_fd >= 0) {
+      dprintf(run->sync_fd, "Hi player%d! (room %d)\n", i, i / 3);
+    } else {
+      log_printf(LOG_INFO, "Hi player%d! (room %d)\n", i, i / 3);
+    }
+    call = now_ns() - call;
+    if (call > run->worst_ns) {
+      run->worst_ns = call;
+    }
+  }
+  run->ns = now_ns() - start;
+  return NULL;
+}
+
+/**
+ * @brief Run THREADS loggers into fd
+ * @param sync_fd write synchronously to this fd, -1 logs through log_printf
+ */
+void run_loggers(char *name, int sync_fd) {
+  pthread_t threads[THREADS];
+  struct Run runs[THREADS];
+  for (int t = 0; t < THREADS; t++) {
+    runs[t] = (struct Run){sync_fd, 0, 0};
+    pthread_create(&threads[t], NULL, logger, &runs[t]);
+  }
+  long long ns = 0;
+  long long worst_ns = 0;
+  for (int t = 0; t < THREADS; t++) {
+    pthread_join(threads[t], NULL);
+    ns += runs[t].ns;
+    if (runs[t].worst_ns > worst_ns) {
+      worst_ns = runs[t].worst_ns;
+    }
+  }
+  double call_ns = (double)ns / ((double)THREADS * LINES);
+  printf("%-14s %12.1f %14.1f\n", name, call_ns, worst_ns / 1000.0);
+  bench_result("log", name, "call_ns", call_ns);
+  bench_result("log", name, "worst_call_us", worst_ns / 1000.0);
+}
+
+int main(int argc, char **argv) {
+  int fds[2];
+  if (pipe(fds) < 0) {
+    failwith("Could not create a pipe");
+  }
+  pthread_t drain;
+  pthread_create(&drain, NULL, reader, &fds[0]);
+  if (log_start(fds[1], fds[1]) < 0) {
+    failwith("Could not start the log writer");
+  }
+
+  printf("%-14s %12s %14s\n", "mode", "call_ns", "worst_call_us");
+  char *names[] = {"sync", "async", "sync_stalled", "async_stalled"};
+  for (int i = 0; i < 4; i++) {
+    __atomic_store_n(&Stall, i >= 2, __ATOMIC_RELEASE);
+    run_loggers(names[i], i % 2 == 0 ? fds[1] : -1);
+    log_flush();
+  }
+
+  close(fds[1]);
+  pthread_join(drain, NULL);
+  return 0;
+}
@@ -0,0 +1,100 @@
+/**
+  Question file parsing benchmark
+  generates a large synthetic text question file and times read_questions
+  with 1..N threads, reporting MB/s and the speedup over one thread
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../bank.h"
+#include "bench.h"
+
+/**
+ * DEFINE CONSTANTS
+ */
+const int QUESTIONS = 400000;
+const int ROUNDS = 3;
+int THREAD_COUNTS[] = {1, 2, 4, 8, 16, 0};
+char *BENCH_FILE = "/tmp/trivia_parse_bench.txt";
+
+void failwith(char *message) {
+  fprintf(stderr, "Error: %s\n", message);
+  exit(1);
+}
+
+long long now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief Write QUESTIONS records in the question file format
+ * @return size_t file size in bytes
+ */
+size_t generate_file(char *filename) {
+  FILE *file = fopen(filename, "w");
+  if (file == NULL) {
+    failwith("could not create benchmark question file");
+  }
+  for (int i = 0; i < QUESTIONS; i++) {
+    fprintf(file,
+            "Question number %d: which of these words was picked for it?\n"
+            "alpha%d bravo%d charlie%d\n"
+            "bravo%d\n\n",
+            i, i, i, i, i);
+  }
+  fclose(file);
+
+  struct stat st;
+  stat(filename, &st);
+  return st.st_size;
+}
+
+int main(int argc, char **argv) {
+  size_t size = generate_file(BENCH_FILE);
+  long cores = sysconf(_SC_NPROCESSORS_ONLN);
+  printf("# %d questions, %.1f MB, %ld cores\n", QUESTIONS, size / 1e6,
+         cores);
+  printf("%-8s %10s %10s %8s\n", "threads", "ms", "MB_per_s", "speedup");
+
+  double base_ms = 0;
+  for (int t = 0; THREAD_COUNTS[t] != 0; t++) {
+    int threads = THREAD_COUNTS[t];
+    if (threads > cores * 2) {
+      break;
+    }
+
+    // best of ROUNDS, the first run also warms the page cache
+    long long best = -1;
+    for (int r = 0; r < ROUNDS; r++) {
+      struct QuestionBank bank;
+      long long start = now_ns();
+      int count = read_questions(&bank, BENCH_FILE, threads);
+      long long elapsed = now_ns() - start;
+      if (count != QUESTIONS || bank.num_errors != 0) {
+        failwith("benchmark question file did not parse cleanly");
+      }
+      bank_free(&bank);
+      best = best < 0 || elapsed < best ? elapsed : best;
+    }
+
+    double ms = best / 1e6;
+    base_ms = threads == 1 ? ms : base_ms;
+    double mb_per_sec = size / 1e6 / (ms / 1e3);
+    printf("%-8d %10.1f %10.1f %8.2f\n", threads, ms, mb_per_sec,
+           base_ms / ms);
+
+    char name[32];
+    snprintf(name, sizeof(name), "threads_%d", threads);
+    bench_result("parse", name, "mb_per_sec", mb_per_sec);
+    bench_result("parse", name, "speedup", base_ms / ms);
+  }
+
+  unlink(BENCH_FILE);
+  return 0;
+}
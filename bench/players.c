@@ -0,0 +1,158 @@
+/**
+  Player storage benchmark
+  a model of the fields a grading pass reads, not the server's structs:
+  grades one question for a room of 1M players and finds its leader, once
+  with every player in one record (fd, score, answer and an inline name)
+  and once with the same fields in dense per-seat arrays and names in a
+  shared pool. Reports the bytes each model player takes and the time of
+  a grading pass. A server seat also keeps its struct Player (socket,
+  buffers, session) and the leaderboard's links, in both layouts.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../arena.h"
+#include "bench.h"
+
+/**
+ * DEFINE CONSTANTS
+ */
+const int PLAYERS = 1000000;
+const int PASSES = 20;
+const int CORRECT = 2;
+
+struct SeatRecord {
+  int fd;
+  int score;
+  int choice; // answer to the active question, 0 if none
+  char name[128];
+};
+
+struct Seats {
+  int *fds;
+  int *scores;
+  uint8_t *choices;
+  char **names;
+  struct Arena pool;
+};
+
+// sink so the compiler cannot drop the work
+volatile int Sink;
+
+long long now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief Same players for both layouts: a few seats empty, most answered
+ */
+void player_at(int i, int *fd, int *choice, char *name, size_t len) {
+  *fd = i % 50 == 0 ? -1 : i + 10;
+  *choice = i % 7 == 0 ? 0 : 1 + i % 3;
+  snprintf(name, len, "player%d", i);
+}
+
+/**
+ * @brief ms per pass over records
+ */
+double run_records(struct SeatRecord *seats) {
+  long long start = now_ns();
+  for (int pass = 0; pass < PASSES; pass++) {
+    int leader = -1;
+    for (int i = 0; i < PLAYERS; i++) {
+      struct SeatRecord *seat = &seats[i];
+      if (seat->fd == -1) {
+        continue;
+      }
+      if (seat->choice != 0) {
+        seat->score += seat->choice == CORRECT ? 1 : -1;
+      }
+      if (leader < 0 || seat->score > seats[leader].score) {
+        leader = i;
+      }
+    }
+    Sink = leader;
+  }
+  return (now_ns() - start) / 1e6 / PASSES;
+}
+
+/**
+ * @brief ms per pass over the dense arrays
+ */
+double run_arrays(struct Seats *seats) {
+  long long start = now_ns();
+  for (int pass = 0; pass < PASSES; pass++) {
+    int leader = -1;
+    int best = 0;
+    for (int i = 0; i < PLAYERS; i++) {
+      if (seats->fds[i] == -1) {
+        continue;
+      }
+      int choice = seats->choices[i];
+      if (choice != 0) {
+        seats->scores[i] += choice == CORRECT ? 1 : -1;
+      }
+      if (leader < 0 || seats->scores[i] > best) {
+        leader = i;
+        best = seats->scores[i];
+      }
+    }
+    Sink = leader;
+  }
+  return (now_ns() - start) / 1e6 / PASSES;
+}
+
+int main(int argc, char **argv) {
+  struct SeatRecord *records = calloc(PLAYERS, sizeof(struct SeatRecord));
+  struct Seats seats;
+  seats.fds = malloc(PLAYERS * sizeof(int));
+  seats.scores = calloc(PLAYERS, sizeof(int));
+  seats.choices = malloc(PLAYERS * sizeof(uint8_t));
+  seats.names = malloc(PLAYERS * sizeof(char *));
+  arena_init(&seats.pool);
+  if (records == NULL || seats.fds == NULL || seats.scores == NULL ||
+      seats.choices == NULL || seats.names == NULL) {
+    fprintf(stderr, "Error: Out of memory\n");
+    return 1;
+  }
+
+  for (int i = 0; i < PLAYERS; i++) {
+    int fd, choice;
+    char name[128];
+    player_at(i, &fd, &choice, name, sizeof(name));
+    records[i].fd = fd;
+    records[i].choice = choice;
+    strcpy(records[i].name, name);
+    seats.fds[i] = fd;
+    seats.choices[i] = choice;
+    seats.names[i] = arena_strndup(&seats.pool, name, strlen(name));
+  }
+
+  double record_ms = run_records(records);
+  double array_ms = run_arrays(&seats);
+  double record_bytes = sizeof(struct SeatRecord);
+  double array_bytes = sizeof(int) + sizeof(int) + sizeof(uint8_t) +
+                       sizeof(char *) + (double)seats.pool.used / PLAYERS;
+
+  printf("%-10s %14s %12s\n", "layout", "bytes_player", "pass_ms");
+  printf("%-10s %14.1f %12.2f\n", "records", record_bytes, record_ms);
+  printf("%-10s %14.1f %12.2f\n", "arrays", array_bytes, array_ms);
+  bench_result("players", "records", "bytes_per_player", record_bytes);
+  bench_result("players", "records", "pass_ms", record_ms);
+  bench_result("players", "arrays", "bytes_per_player", array_bytes);
+  bench_result("players", "arrays", "pass_ms", array_ms);
+
+  arena_free(&seats.pool);
+  free(seats.names);
+  free(seats.choices);
+  free(seats.scores);
+  free(seats.fds);
+  free(records);
+  return 0;
+}
@@ -0,0 +1,99 @@
+/**
+  Question order benchmark
+  draws the first 20 questions of a room's order from banks of up to 16M
+  questions with the seeded permutation the server uses, against shuffling
+  an index array per room (Fisher-Yates). Reports the cost of setting up a
+  room plus its draws, and the bytes each room keeps.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../shuffle.h"
+#include "bench.h"
+
+/**
+ * DEFINE CONSTANTS
+ */
+int BANK_SIZES[] = {1000, 1000000, 16000000, 0};
+const int QUESTIONS = 20;
+const int ROOMS = 20000;
+const int SHUFFLED_ROOMS = 5;
+
+// sink so the compiler cannot drop the work
+volatile uint32_t Sink;
+
+long long now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief ns per room with the seeded permutation
+ */
+double run_permutation(int n) {
+  long long start = now_ns();
+  for (int r = 0; r < ROOMS; r++) {
+    struct Shuffle order;
+    shuffle_init(&order, n, shuffle_mix(r));
+    for (int q = 0; q < QUESTIONS; q++) {
+      Sink ^= shuffle_get(&order, q);
+    }
+  }
+  return (double)(now_ns() - start) / ROOMS;
+}
+
+/**
+ * @brief ns per room with a shuffled index array per room
+ */
+double run_array(int n) {
+  uint32_t *order = malloc(n * sizeof(uint32_t));
+  if (order == NULL) {
+    return -1;
+  }
+  long long start = now_ns();
+  uint64_t state = 1;
+  for (int r = 0; r < SHUFFLED_ROOMS; r++) {
+    for (int i = 0; i < n; i++) {
+      order[i] = i;
+    }
+    for (int i = n - 1; i > 0; i--) {
+      state = shuffle_mix(state);
+      int j = state % (i + 1);
+      uint32_t swap = order[i];
+      order[i] = order[j];
+      order[j] = swap;
+    }
+    for (int q = 0; q < QUESTIONS; q++) {
+      Sink ^= order[q];
+    }
+  }
+  double ns = (double)(now_ns() - start) / SHUFFLED_ROOMS;
+  free(order);
+  return ns;
+}
+
+int main(int argc, char **argv) {
+  printf("%10s %16s %16s %14s %14s\n", "bank", "permutation_ns",
+         "array_ns", "perm_bytes", "array_bytes");
+  for (int b = 0; BANK_SIZES[b] != 0; b++) {
+    int n = BANK_SIZES[b];
+    double permutation = run_permutation(n);
+    double array = run_array(n);
+    size_t array_bytes = (size_t)n * sizeof(uint32_t);
+    printf("%10d %16.1f %16.1f %14zu %14zu\n", n, permutation, array,
+           sizeof(struct Shuffle), array_bytes);
+
+    char name[32];
+    snprintf(name, sizeof(name), "bank_%d", n);
+    bench_result("shuffle", name, "permutation_ns_per_room", permutation);
+    bench_result("shuffle", name, "array_ns_per_room", array);
+    bench_result("shuffle", name, "permutation_bytes_per_room",
+                 sizeof(struct Shuffle));
+    bench_result("shuffle", name, "array_bytes_per_room", array_bytes);
+  }
+  return 0;
+}
@@ -0,0 +1,79 @@
+/**
+  Timer wheel benchmark
+  arms one deadline per room for hundreds of thousands of rooms, re-arms
+  them as answers come in and lets the rest expire, reporting the cost per
+  operation as the number of armed timers grows
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../timer.h"
+#include "bench.h"
+
+/**
+ * DEFINE CONSTANTS
+ */
+int ROOM_COUNTS[] = {1000, 10000, 100000, 500000, 0};
+// answer window in ticks (20 s at 10 ms)
+const int WINDOW = 2000;
+
+long Fired;
+
+long long now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void on_deadline(void *arg) { Fired++; }
+
+int main(int argc, char **argv) {
+  printf("%-8s %12s %12s %12s\n", "rooms", "arm_ns", "rearm_ns", "expire_ns");
+
+  for (int c = 0; ROOM_COUNTS[c] != 0; c++) {
+    int n = ROOM_COUNTS[c];
+    struct Timer *timers = malloc(sizeof(struct Timer) * n);
+    struct TimerWheel *wheel = malloc(sizeof(struct TimerWheel));
+    wheel_init(wheel, 0);
+    for (int i = 0; i < n; i++) {
+      timer_init(&timers[i], on_deadline, NULL);
+    }
+
+    // every room asks a question, spread over the first window
+    long long start = now_ns();
+    for (int i = 0; i < n; i++) {
+      timer_schedule(wheel, &timers[i], WINDOW + i % WINDOW);
+    }
+    double arm_ns = (double)(now_ns() - start) / n;
+
+    // everyone answers in half the rooms: next question, new deadline
+    start = now_ns();
+    for (int i = 0; i < n; i += 2) {
+      timer_schedule(wheel, &timers[i], WINDOW * 2 + i % WINDOW);
+    }
+    double rearm_ns = (double)(now_ns() - start) / ((n + 1) / 2);
+
+    // run the clock until every deadline has fired
+    Fired = 0;
+    start = now_ns();
+    wheel_advance(wheel, WINDOW * 3);
+    double expire_ns = (double)(now_ns() - start) / n;
+    if (Fired != n || wheel->count != 0) {
+      fprintf(stderr, "Error: %ld of %d timers fired\n", Fired, n);
+      return 1;
+    }
+
+    printf("%-8d %12.1f %12.1f %12.1f\n", n, arm_ns, rearm_ns, expire_ns);
+    char name[32];
+    snprintf(name, sizeof(name), "rooms_%d", n);
+    bench_result("timers", name, "arm_ns", arm_ns);
+    bench_result("timers", name, "rearm_ns", rearm_ns);
+    bench_result("timers", name, "expire_ns", expire_ns);
+
+    free(wheel);
+    free(timers);
+  }
+  return 0;
+}
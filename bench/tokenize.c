@@ -0,0 +1,143 @@
+/**
+  Message tokenizer microbenchmark
+  compares the original strdup + strsep + strcpy split_by_delim against the
+  in-place parse_message field views, reporting messages/sec and (where the
+  kernel allows perf events) cache misses per message
+*/
+
+#include <linux/perf_event.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../proto.h"
+#include "bench.h"
+
+/**
+ * DEFINE CONSTANTS
+ */
+const int ITERATIONS = 200000;
+
+char *MESSAGES[] = {
+    "3|0|Who sang the title song for the latest Bond film, No Time to "
+    "Die?|Adele|Sam_Smith|Billie_Eilish",
+    "5|Billie_Eilish",
+    "4|2",
+    "1|benicio",
+    NULL,
+};
+
+// sink so the compiler cannot drop the parsing work
+volatile size_t Sink;
+
+/**
+ * @brief Split string by delim into string[]
+ * verbatim copy of the original implementation, kept as the baseline
+ */
+int split_by_delim(char dest[128][1024], char *str, char *delim) {
+  char *src_str = strdup(str); // malloc()
+  char *src_str_saveptr = src_str;
+  char *found;
+
+  int result_pos = 0;
+
+  // string spot
+  while ((found = strsep(&src_str, delim)) != NULL) {
+    strcpy(dest[result_pos], found);
+    result_pos++;
+  }
+
+  free(found);
+  free(src_str_saveptr);
+  return result_pos + 1;
+}
+
+long long now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief Open a hardware cache-miss counter for this thread
+ * @return int fd, -1 if perf events are unavailable
+ */
+int open_cache_counter() {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof(attr);
+  attr.config = PERF_COUNT_HW_CACHE_MISSES;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+void run_split(char *message) {
+  char args[128][1024];
+  int n = split_by_delim(args, message, "|");
+  Sink += n + args[0][0];
+}
+
+void run_fields(char *message) {
+  struct Field fields[MAX_FIELDS];
+  int type = parse_message(message, strlen(message), fields);
+  Sink += type + fields[0].len;
+}
+
+void measure(char *name, void (*run)(char *), int counter) {
+  int num_messages = 0;
+  while (MESSAGES[num_messages] != NULL) {
+    num_messages++;
+  }
+
+  if (counter >= 0) {
+    ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+    ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+  }
+  long long start = now_ns();
+  for (int i = 0; i < ITERATIONS; i++) {
+    run(MESSAGES[i % num_messages]);
+  }
+  long long elapsed = now_ns() - start;
+
+  long long misses = -1;
+  if (counter >= 0) {
+    ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(counter, &misses, sizeof(misses)) != sizeof(misses)) {
+      misses = -1;
+    }
+  }
+
+  double per_sec = ITERATIONS / (elapsed / 1e9);
+  bench_result("tokenize", name, "msgs_per_sec", per_sec);
+  if (misses >= 0) {
+    printf("%-15s %14.0f %16.3f\n", name, per_sec,
+           (double)misses / ITERATIONS);
+    bench_result("tokenize", name, "misses_per_msg",
+                 (double)misses / ITERATIONS);
+  } else {
+    printf("%-15s %14.0f %16s\n", name, per_sec, "n/a");
+  }
+}
+
+int main(int argc, char **argv) {
+  int counter = open_cache_counter();
+  if (counter < 0) {
+    printf("# perf events unavailable, cache misses not reported\n");
+  }
+
+  printf("%-15s %14s %16s\n", "tokenizer", "msgs_per_sec", "misses_per_msg");
+  measure("split_by_delim", run_split, counter);
+  measure("parse_message", run_fields, counter);
+
+  if (counter >= 0) {
+    close(counter);
+  }
+  return 0;
+}
@@ -0,0 +1,317 @@
+/**
+  epoll vs io_uring game round benchmark
+  plays rounds against socketpair "players" the way the server does: a
+  question broadcast, every player's answer read back, then the answer and
+  leaderboard frames. The epoll loop sends each frame with its own
+  sendmsg and reads until EAGAIN; the io_uring loop reads with one
+  multishot receive per player from a provided buffer ring and submits one
+  gathered send per player per phase. Reports server-side syscalls per
+  round and thread CPU per round scaled to 10k players.
+*/
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../proto.h"
+#include "../uring.h"
+#include "bench.h"
+
+/**
+ * DEFINE CONSTANTS
+ */
+const int ROUNDS = 20;
+const int MAX_EVENTS = 1024;
+int PLAYER_COUNTS[] = {100, 1000, 10000, 0};
+#define BUFS 16384
+#define BUF_SIZE 64
+
+struct Conn {
+  int fd;   // server side
+  int peer; // player side
+  struct OutQueue outbox;
+  struct msghdr msg;
+  struct iovec iov[4];
+};
+
+long long Syscalls;
+
+void failwith(char *message) {
+  fprintf(stderr, "Error: %s\n", message);
+  exit(1);
+}
+
+long long cpu_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief Player side: answer the question (not measured)
+ */
+void players_answer(struct Conn *conns, int n) {
+  char answer[] = {0, 3, '4', '|', '2'};
+  for (int i = 0; i < n; i++) {
+    if (write(conns[i].peer, answer, sizeof(answer)) != sizeof(answer)) {
+      failwith("player write failed");
+    }
+  }
+}
+
+/**
+ * @brief Player side: read whatever the server sent (not measured)
+ */
+void players_drain(struct Conn *conns, int n) {
+  char buf[4096];
+  for (int i = 0; i < n; i++) {
+    while (recv(conns[i].peer, buf, sizeof(buf), MSG_DONTWAIT) > 0) {
+    }
+  }
+}
+
+void epoll_send(struct Conn *conn, struct OutBuf *frame) {
+  outq_push(&conn->outbox, frame);
+  Syscalls++;
+  if (outq_flush(&conn->outbox, conn->fd) != 0) {
+    failwith("epoll send did not complete");
+  }
+}
+
+void round_epoll(struct Conn *conns, int n, int epoll_fd,
+                 struct OutBuf *frames[3], long long *cpu) {
+  struct epoll_event events[MAX_EVENTS];
+  char buf[BUF_SIZE];
+
+  long long start = cpu_ns();
+  for (int i = 0; i < n; i++) {
+    epoll_send(&conns[i], frames[0]);
+  }
+  *cpu += cpu_ns() - start;
+
+  players_drain(conns, n);
+  players_answer(conns, n);
+
+  start = cpu_ns();
+  int answers = 0;
+  while (answers < n) {
+    Syscalls++;
+    int ready = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+    if (ready < 0) {
+      failwith("epoll_wait failed");
+    }
+    for (int e = 0; e < ready; e++) {
+      struct Conn *conn = events[e].data.ptr;
+      // edge-triggered: read until EAGAIN
+      ssize_t got;
+      do {
+        Syscalls++;
+        got = recv(conn->fd, buf, sizeof(buf), MSG_DONTWAIT);
+        answers += got > 0;
+      } while (got > 0);
+    }
+  }
+  for (int i = 0; i < n; i++) {
+    epoll_send(&conns[i], frames[1]);
+    epoll_send(&conns[i], frames[2]);
+  }
+  *cpu += cpu_ns() - start;
+
+  players_drain(conns, n);
+}
+
+/**
+ * @brief Submit one gathered send per player and wait for all of them
+ */
+void uring_broadcast(struct Uring *ring, struct Conn *conns, int n) {
+  for (int i = 0; i < n; i++) {
+    struct io_uring_sqe *sqe = uring_sqe(ring);
+    if (sqe == NULL) {
+      failwith("submission queue full");
+    }
+    memset(&conns[i].msg, 0, sizeof(conns[i].msg));
+    conns[i].msg.msg_iov = conns[i].iov;
+    conns[i].msg.msg_iovlen = outq_iov(&conns[i].outbox, conns[i].iov, 4);
+    uring_prep_sendmsg(sqe, conns[i].fd, &conns[i].msg, MSG_NOSIGNAL, i);
+  }
+
+  int done = 0;
+  while (done < n) {
+    if (uring_submit(ring, 1) < 0 && errno != EINTR) {
+      failwith("io_uring_enter failed");
+    }
+    struct io_uring_cqe *cqe;
+    while ((cqe = uring_peek(ring)) != NULL) {
+      struct Conn *conn = &conns[cqe->user_data];
+      if (cqe->res < 0) {
+        failwith("io_uring send failed");
+      }
+      outq_consume(&conn->outbox, cqe->res);
+      uring_seen(ring);
+      done++;
+    }
+  }
+}
+
+void round_uring(struct Conn *conns, int n, struct Uring *ring,
+                 struct UringBufRing *bufs, struct OutBuf *frames[3],
+                 long long *cpu) {
+  long long start = cpu_ns();
+  for (int i = 0; i < n; i++) {
+    outq_push(&conns[i].outbox, frames[0]);
+  }
+  uring_broadcast(ring, conns, n);
+  *cpu += cpu_ns() - start;
+
+  players_drain(conns, n);
+  players_answer(conns, n);
+
+  start = cpu_ns();
+  int answers = 0;
+  while (answers < n) {
+    if (uring_submit(ring, 1) < 0 && errno != EINTR) {
+      failwith("io_uring_enter failed");
+    }
+    struct io_uring_cqe *cqe;
+    while ((cqe = uring_peek(ring)) != NULL) {
+      struct Conn *conn = &conns[cqe->user_data];
+      int res = cqe->res;
+      unsigned flags = cqe->flags;
+      uring_seen(ring);
+      if (flags & IORING_CQE_F_BUFFER) {
+        uring_buf_recycle(bufs, flags >> IORING_CQE_BUFFER_SHIFT);
+      }
+      if (res > 0) {
+        answers++;
+      } else if (res != -ENOBUFS) {
+        failwith("io_uring recv failed");
+      }
+      if (!(flags & IORING_CQE_F_MORE)) {
+        uring_prep_recv(uring_sqe(ring), conn->fd, bufs->group,
+                        conn - conns);
+      }
+    }
+  }
+  for (int i = 0; i < n; i++) {
+    outq_push(&conns[i].outbox, frames[1]);
+    outq_push(&conns[i].outbox, frames[2]);
+  }
+  uring_broadcast(ring, conns, n);
+  *cpu += cpu_ns() - start;
+
+  players_drain(conns, n);
+}
+
+void report(char *loop, int n, long long syscalls, long long cpu) {
+  double per_round = (double)syscalls / ROUNDS;
+  double cpu_us = cpu / 1000.0 / ROUNDS * (10000.0 / n);
+  printf("%-7s %8d %18.1f %16.1f\n", loop, n, per_round, cpu_us);
+
+  char name[64];
+  snprintf(name, sizeof(name), "%s_%d", loop, n);
+  bench_result("uring", name, "syscalls_per_round", per_round);
+  bench_result("uring", name, "cpu_us_per_round_10k", cpu_us);
+}
+
+int main(int argc, char **argv) {
+  struct rlimit limit;
+  getrlimit(RLIMIT_NOFILE, &limit);
+  limit.rlim_cur = limit.rlim_max;
+  setrlimit(RLIMIT_NOFILE, &limit);
+  int max_players = (int)((limit.rlim_cur - 64) / 2);
+
+  struct OutBuf *frames[3];
+  frames[0] = outbuf_printf("%d|%d|%s|%s|%s|%s", QUESTION_SEND, 0,
+                            "Who sang the title song for the latest Bond "
+                            "film, No Time to Die?",
+                            "Adele", "Sam_Smith", "Billie_Eilish");
+  frames[1] = outbuf_printf("%d|%s", ANSWER_BROADCAST, "Billie_Eilish");
+  frames[2] = outbuf_printf("%d|%d|%d|%s", LEADERBOARD, 1, 3,
+                            "1:3:alice,2:2:bob,3:1:carol");
+
+  struct Uring probe;
+  int have_uring = uring_init(&probe, 8) == 0;
+  if (have_uring) {
+    uring_free(&probe);
+  } else {
+    printf("# io_uring unavailable (%s), epoll only\n", strerror(errno));
+  }
+
+  printf("%-7s %8s %18s %16s\n", "loop", "players", "syscalls_per_round",
+         "cpu_us_per_10k");
+  for (int c = 0; PLAYER_COUNTS[c] != 0; c++) {
+    int n = PLAYER_COUNTS[c];
+    if (n > max_players) {
+      printf("# %d players capped at %d (fd limit %llu)\n", n, max_players,
+             (unsigned long long)limit.rlim_cur);
+      n = max_players;
+    }
+
+    struct Conn *conns = calloc(n, sizeof(struct Conn));
+    int epoll_fd = epoll_create1(0);
+    for (int i = 0; i < n; i++) {
+      int pair[2];
+      if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, pair) < 0) {
+        failwith(strerror(errno));
+      }
+      conns[i].fd = pair[0];
+      conns[i].peer = pair[1];
+      outq_init(&conns[i].outbox);
+
+      struct epoll_event ev;
+      memset(&ev, 0, sizeof(ev));
+      ev.events = EPOLLIN | EPOLLET;
+      ev.data.ptr = &conns[i];
+      epoll_ctl(epoll_fd, EPOLL_CTL_ADD, conns[i].fd, &ev);
+    }
+
+    Syscalls = 0;
+    long long cpu = 0;
+    for (int r = 0; r < ROUNDS; r++) {
+      round_epoll(conns, n, epoll_fd, frames, &cpu);
+    }
+    report("epoll", n, Syscalls, cpu);
+    close(epoll_fd);
+
+    if (have_uring) {
+      struct Uring ring;
+      struct UringBufRing bufs;
+      if (uring_init(&ring, 8192) < 0 ||
+          uring_buf_ring_init(&ring, &bufs, 0, BUFS, BUF_SIZE) < 0) {
+        failwith("io_uring setup failed");
+      }
+      for (int i = 0; i < n; i++) {
+        uring_prep_recv(uring_sqe(&ring), conns[i].fd, bufs.group, i);
+      }
+      uring_submit(&ring, 0);
+
+      ring.enters = 0;
+      cpu = 0;
+      for (int r = 0; r < ROUNDS; r++) {
+        round_uring(conns, n, &ring, &bufs, frames, &cpu);
+      }
+      report("uring", n, ring.enters, cpu);
+      uring_buf_ring_free(&ring, &bufs);
+      uring_free(&ring);
+    }
+
+    for (int i = 0; i < n; i++) {
+      outq_clear(&conns[i].outbox);
+      close(conns[i].fd);
+      close(conns[i].peer);
+    }
+    free(conns);
+  }
+
+  for (int i = 0; i < 3; i++) {
+    outbuf_release(frames[i]);
+  }
+  return 0;
+}
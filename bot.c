@@ -0,0 +1,604 @@
+/**
+  Headless load generator
+  runs many simulated players from one epoll loop: each bot registers a
+  name, answers questions after a random think time and reconnects when
+  its game ends. Reports the latency from each bot request to the next
+  frame the server sends that bot, as p50/p99/p999.
+*/
+
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bank.h"
+#include "bench/bench.h"
+#include "hist.h"
+#include "proto.h"
+
+/**
+ * DEFINE CONSTANTS
+ */
+int STRLEN = 1024;
+char *DEFAULT_IP = "127.0.0.1";
+const int MAX_EVENTS = 1024;
+#define INBOX_SIZE FRAME_RING
+// players per room (the server's max_players), every one sees each round
+int ROOM_SIZE = 3;
+
+// message types a bot sends and times
+enum { LAT_NAME, LAT_ANSWER, LAT_KINDS };
+char *LAT_NAMES[] = {"NAME_RETURN", "QUESTION_RESPONSE"};
+
+struct Bot {
+  int id;
+  int fd;
+  int connecting;
+  int generation;      // bumped on every reconnect, stales old timers
+  int question;        // bank index of the open question, -1 if none
+  long long sent_at;   // send time of the outstanding request, 0 if none
+  int sent_kind;
+  struct RingBuf inbox;
+};
+
+/**
+  Pending answer, kept in a min-heap on `due`.
+  Timers are never removed; a timer whose bot moved on is skipped.
+ */
+struct Timer {
+  long long due;
+  int bot;
+  int generation;
+  int question;
+};
+
+struct Timers {
+  struct Timer *heap;
+  int count;
+  int capacity;
+};
+
+struct Load {
+  struct sockaddr_in addr;
+  struct Bot *bots;
+  int num_bots;
+  int epoll_fd;
+  int running;
+  struct Timers timers;
+  struct QuestionBank *bank; // NULL: answer at random
+  double think_ms;
+  int accuracy;
+  struct Histogram latency[LAT_KINDS];
+  long connects;
+  long connect_failures;
+  long games;
+  long answers_seen;
+  long frames;
+};
+
+void failwith(char *message) {
+  fprintf(stderr, "Error: %s\n", message);
+  exit(1);
+}
+
+/**
+ * @brief print help doc with name of executable inserted
+ *
+ * @param execname
+ */
+void print_help(char *execname) {
+  printf("Usage: %s [-i IP_address] [-p port_number] [-n bots] "
+         "[-d seconds] [-l think_ms] [-a accuracy] [-f question_file] "
+         "[-r room_size] [-h]\n",
+         execname);
+  printf("\n");
+  printf("  -i IP_address       Default to \"127.0.0.1\";\n");
+  printf("  -p port_number      Default to 25555;\n");
+  printf("  -n bots             Simulated players, default to 300;\n");
+  printf("  -d seconds          Length of the run, default to 10;\n");
+  printf("  -l think_ms         Mean (exponential) answer delay, default to "
+         "50;\n");
+  printf("  -a accuracy         Percent of answers that are correct, default "
+         "to 70;\n");
+  printf("                      (needs -f, answers are random otherwise)\n");
+  printf("  -f question_file    The server's question file;\n");
+  printf("  -r room_size        The server's max_players, default to 3;\n");
+  printf("  -h                  Display this help info.\n");
+}
+
+long long now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void timer_push(struct Timers *timers, struct Timer timer) {
+  if (timers->count == timers->capacity) {
+    int capacity = timers->capacity ? timers->capacity * 2 : 1024;
+    struct Timer *heap = realloc(timers->heap, sizeof(struct Timer) * capacity);
+    if (heap == NULL) {
+      failwith("Failed to allocate timers.");
+    }
+    timers->heap = heap;
+    timers->capacity = capacity;
+  }
+
+  // sift up
+  int pos = timers->count++;
+  while (pos > 0 && timers->heap[(pos - 1) / 2].due > timer.due) {
+    timers->heap[pos] = timers->heap[(pos - 1) / 2];
+    pos = (pos - 1) / 2;
+  }
+  timers->heap[pos] = timer;
+}
+
+struct Timer timer_pop(struct Timers *timers) {
+  struct Timer top = timers->heap[0];
+  struct Timer last = timers->heap[--timers->count];
+
+  // sift down
+  int pos = 0;
+  while (1) {
+    int child = pos * 2 + 1;
+    if (child >= timers->count) {
+      break;
+    }
+    if (child + 1 < timers->count &&
+        timers->heap[child + 1].due < timers->heap[child].due) {
+      child++;
+    }
+    if (timers->heap[child].due >= last.due) {
+      break;
+    }
+    timers->heap[pos] = timers->heap[child];
+    pos = child;
+  }
+  timers->heap[pos] = last;
+  return top;
+}
+
+/**
+ * @brief Send a frame, recording the send time for the latency histogram
+ */
+void bot_send(struct Load *load, struct Bot *bot, int kind, char *frame,
+              int length) {
+  if (send(bot->fd, frame, length, MSG_DONTWAIT | MSG_NOSIGNAL) != length) {
+    return;
+  }
+  bot->sent_at = now_ns();
+  bot->sent_kind = kind;
+}
+
+void bot_connect(struct Load *load, struct Bot *bot) {
+  bot->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  if (bot->fd < 0) {
+    failwith("Failed to create socket.");
+  }
+  // bots write tiny frames and wait for replies, never let Nagle hold them
+  int nodelay = 1;
+  setsockopt(bot->fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+  bot->connecting = 1;
+  bot->generation++;
+  bot->question = -1;
+  bot->sent_at = 0;
+  bot->inbox.head = bot->inbox.tail = 0;
+
+  if (connect(bot->fd, (struct sockaddr *)&load->addr, sizeof(load->addr)) <
+          0 &&
+      errno != EINPROGRESS) {
+    perror("connect");
+    failwith("Failed to connect to server.");
+  }
+
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
+  ev.data.ptr = bot;
+  if (epoll_ctl(load->epoll_fd, EPOLL_CTL_ADD, bot->fd, &ev) < 0) {
+    failwith("epoll_ctl failed");
+  }
+  load->connects++;
+}
+
+/**
+ * @brief Drop the connection, starting a new one while the run lasts
+ */
+void bot_closed(struct Load *load, struct Bot *bot) {
+  epoll_ctl(load->epoll_fd, EPOLL_CTL_DEL, bot->fd, NULL);
+  close(bot->fd);
+  bot->fd = -1;
+  if (load->running) {
+    bot_connect(load, bot);
+  }
+}
+
+/**
+ * @brief Pick an answer (1-3) for a question
+ * correct `accuracy` percent of the time when the bank is known
+ */
+int pick_answer(struct Load *load, int question) {
+  if (load->bank == NULL || question < 0 || question >= load->bank->count) {
+    return rand() % 3 + 1;
+  }
+  int correct = bank_answer(load->bank, question);
+  if (rand() % 100 < load->accuracy) {
+    return correct + 1;
+  }
+  return (correct + 1 + rand() % 2) % 3 + 1;
+}
+
+/**
+  Handle one server message
+  payload is a view into the bot's inbox and is tokenized in place
+ */
+void handle_message(struct Load *load, struct Bot *bot, char *payload,
+                    size_t length) {
+  struct Field args[MAX_FIELDS];
+  int type = parse_message(payload, length, args);
+  if (type < 0) {
+    fprintf(stderr, "Recieved malformed message! %.*s\n", (int)length,
+            payload);
+    return;
+  }
+
+  switch (type) {
+  // register under a unique name
+  case NAME_QUERY: {
+    char frame[256];
+    int length =
+        frame_printf(frame, sizeof(frame), "%d|bot%d", NAME_RETURN, bot->id);
+    bot_send(load, bot, LAT_NAME, frame, length);
+  } break;
+
+  // schedule an answer after an exponential think time
+  case QUESTION_SEND: {
+    bot->question = field_int(args[1]);
+    double think = -log(1.0 - (double)rand() / ((double)RAND_MAX + 1.0)) *
+                   load->think_ms;
+    struct Timer timer = {now_ns() + (long long)(think * 1e6), bot->id,
+                          bot->generation, bot->question};
+    timer_push(&load->timers, timer);
+  } break;
+
+  // question over, a pending answer is no longer wanted
+  case ANSWER_BROADCAST: {
+    load->answers_seen++;
+    bot->question = -1;
+  } break;
+
+  // game over, start another
+  case FECKOFF: {
+    load->games++;
+    bot_closed(load, bot);
+  } break;
+  }
+}
+
+/**
+ * @brief Drain a readable bot socket (edge-triggered)
+ */
+void bot_readable(struct Load *load, struct Bot *bot) {
+  char scratch[FRAME_MAX];
+
+  while (bot->fd != -1) {
+    ssize_t amount = ring_fill(&bot->inbox, bot->fd, MSG_DONTWAIT);
+    if (amount < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      return;
+    }
+    if (amount < 0 && errno == EINTR) {
+      continue;
+    }
+    if (amount < 1) {
+      bot_closed(load, bot);
+      return;
+    }
+
+    long long now = now_ns();
+    int generation = bot->generation;
+    char *payload;
+    size_t payload_len;
+    int status;
+    while (generation == bot->generation &&
+           (status = ring_next_frame(&bot->inbox, scratch, &payload,
+                                     &payload_len)) == 1) {
+      load->frames++;
+      if (bot->sent_at != 0) {
+        hist_record(&load->latency[bot->sent_kind], now - bot->sent_at);
+        bot->sent_at = 0;
+      }
+      handle_message(load, bot, payload, payload_len);
+    }
+    if (generation == bot->generation && status < 0) {
+      fprintf(stderr, "Recieved oversized frame from server.\n");
+      bot_closed(load, bot);
+      return;
+    }
+  }
+}
+
+/**
+ * @brief Send every answer that is due
+ * @return int ms until the next timer, -1 if there are none
+ */
+int fire_timers(struct Load *load) {
+  while (load->timers.count > 0) {
+    long long now = now_ns();
+    struct Timer *next = &load->timers.heap[0];
+    if (next->due > now) {
+      return (int)((next->due - now) / 1000000) + 1;
+    }
+
+    struct Timer timer = timer_pop(&load->timers);
+    struct Bot *bot = &load->bots[timer.bot];
+    if (bot->fd == -1 || bot->generation != timer.generation ||
+        bot->question != timer.question) {
+      continue;
+    }
+
+    char frame[64];
+    int length = frame_printf(frame, sizeof(frame), "%d|%d", QUESTION_RESPONSE,
+                              pick_answer(load, timer.question));
+    bot_send(load, bot, LAT_ANSWER, frame, length);
+  }
+  return -1;
+}
+
+void run(struct Load *load, double seconds) {
+  struct epoll_event events[MAX_EVENTS];
+  long long end = now_ns() + (long long)(seconds * 1e9);
+
+  load->running = 1;
+  for (int i = 0; i < load->num_bots; i++) {
+    bot_connect(load, &load->bots[i]);
+  }
+
+  while (1) {
+    int timeout = fire_timers(load);
+    long long left = (end - now_ns()) / 1000000;
+    if (left <= 0) {
+      break;
+    }
+    if (timeout < 0 || timeout > left) {
+      timeout = (int)left;
+    }
+
+    int ready = epoll_wait(load->epoll_fd, events, MAX_EVENTS, timeout);
+    if (ready < 0 && errno != EINTR) {
+      failwith("epoll_wait failed");
+    }
+
+    for (int i = 0; i < ready; i++) {
+      struct Bot *bot = events[i].data.ptr;
+      if (bot->connecting && (events[i].events & (EPOLLOUT | EPOLLERR))) {
+        int error = 0;
+        socklen_t error_len = sizeof(error);
+        getsockopt(bot->fd, SOL_SOCKET, SO_ERROR, &error, &error_len);
+        if (error != 0) {
+          load->connect_failures++;
+          bot_closed(load, bot);
+          continue;
+        }
+        bot->connecting = 0;
+      }
+      if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+        bot_readable(load, bot);
+      }
+    }
+  }
+
+  load->running = 0;
+  for (int i = 0; i < load->num_bots; i++) {
+    if (load->bots[i].fd != -1) {
+      bot_closed(load, &load->bots[i]);
+    }
+  }
+}
+
+/**
+ * @brief Print the run's totals and latency percentiles
+ * results are also recorded for make bench (see bench/bench.h)
+ */
+void report(struct Load *load, double seconds) {
+  long games = load->games / ROOM_SIZE;
+  double rounds_per_sec = load->answers_seen / ROOM_SIZE / seconds;
+  printf("%-12s %8s %8s %10s %14s %14s\n", "connections", "failed", "games",
+         "frames", "frames_per_sec", "rounds_per_sec");
+  printf("%-12ld %8ld %8ld %10ld %14.0f %14.0f\n", load->connects,
+         load->connect_failures, games, load->frames,
+         load->frames / seconds, rounds_per_sec);
+
+  char name[32];
+  snprintf(name, sizeof(name), "bots_%d", load->num_bots);
+  bench_result("bot", name, "games_per_sec", games / seconds);
+  bench_result("bot", name, "rounds_per_sec", rounds_per_sec);
+  bench_result("bot", name, "frames_per_sec", load->frames / seconds);
+  printf("\n");
+  printf("%-18s %9s %9s %9s %9s %9s\n", "request", "count", "p50_us",
+         "p99_us", "p999_us", "max_us");
+  for (int i = 0; i < LAT_KINDS; i++) {
+    struct Histogram *hist = &load->latency[i];
+    printf("%-18s %9llu %9.1f %9.1f %9.1f %9.1f\n", LAT_NAMES[i],
+           (unsigned long long)hist->count, hist_percentile(hist, 50) / 1e3,
+           hist_percentile(hist, 99) / 1e3, hist_percentile(hist, 99.9) / 1e3,
+           hist->max / 1e3);
+
+    char metric[64];
+    snprintf(metric, sizeof(metric), "%s_p50_us", LAT_NAMES[i]);
+    bench_result("bot", name, metric, hist_percentile(hist, 50) / 1e3);
+    snprintf(metric, sizeof(metric), "%s_p99_us", LAT_NAMES[i]);
+    bench_result("bot", name, metric, hist_percentile(hist, 99) / 1e3);
+    snprintf(metric, sizeof(metric), "%s_p999_us", LAT_NAMES[i]);
+    bench_result("bot", name, metric, hist_percentile(hist, 99.9) / 1e3);
+  }
+}
+
+int main(int argc, char **argv) {
+  char ip[STRLEN];
+  char question_file[STRLEN];
+  int port = 25555;
+  int num_bots = 300;
+  double seconds = 10;
+  double think_ms = 50;
+  int accuracy = 70;
+  int help = 0;
+
+  // set up string argument defaults
+  strcpy(ip, DEFAULT_IP);
+  memset(question_file, 0, sizeof(char) * STRLEN);
+
+  /**
+   * parse process arguments
+   */
+  int opt;
+  opterr = 0;
+  while ((opt = getopt(argc, argv, "i:p:n:d:l:a:f:r:h")) != -1) {
+    switch (opt) {
+    case 'i': {
+      if (strlen(optarg) >= STRLEN) {
+        failwith("IP argument too long");
+      }
+      strcpy(ip, optarg);
+    } break;
+
+    case 'p': {
+      port = atoi(optarg);
+      if (port == 0) {
+        failwith("Invalid port");
+      }
+    } break;
+
+    case 'n': {
+      num_bots = atoi(optarg);
+      if (num_bots < 1) {
+        failwith("Invalid bot count");
+      }
+    } break;
+
+    case 'd': {
+      seconds = atof(optarg);
+      if (seconds <= 0) {
+        failwith("Invalid duration");
+      }
+    } break;
+
+    case 'l': {
+      think_ms = atof(optarg);
+      if (think_ms < 0) {
+        failwith("Invalid think time");
+      }
+    } break;
+
+    case 'a': {
+      accuracy = atoi(optarg);
+      if (accuracy < 0 || accuracy > 100) {
+        failwith("Accuracy must be a percentage");
+      }
+    } break;
+
+    case 'f': {
+      if (strlen(optarg) >= STRLEN) {
+        failwith("file argument too long");
+      }
+      strcpy(question_file, optarg);
+    } break;
+
+    case 'r': {
+      ROOM_SIZE = atoi(optarg);
+      if (ROOM_SIZE < 1) {
+        failwith("Invalid room size");
+      }
+    } break;
+
+    case 'h': {
+      help = 1;
+    } break;
+
+    case '?': {
+      fprintf(stderr, "Error: Unknown option '-%c' recieved.\n", optopt);
+      exit(1);
+    } break;
+    }
+  }
+
+  if (help) {
+    print_help(argv[0]);
+    exit(0);
+  }
+
+  // every bot holds a socket
+  struct rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+    if (limit.rlim_cur < (rlim_t)num_bots + 16) {
+      failwith("Bot count exceeds the open file limit");
+    }
+  }
+
+  struct Load load;
+  memset(&load, 0, sizeof(load));
+  load.addr.sin_family = AF_INET;
+  load.addr.sin_addr.s_addr = inet_addr(ip);
+  load.addr.sin_port = htons(port);
+  load.num_bots = num_bots;
+  load.think_ms = think_ms;
+  load.accuracy = accuracy;
+  for (int i = 0; i < LAT_KINDS; i++) {
+    hist_init(&load.latency[i]);
+  }
+
+  // the question file tells bots which answers are correct
+  struct QuestionBank bank;
+  if (question_file[0] != 0) {
+    if (bank_is_compiled(question_file)) {
+      if (bank_map(&bank, question_file) < 0) {
+        failwith("Failed to load question bank.");
+      }
+    } else if (read_questions(&bank, question_file, 1) < 0) {
+      failwith("Failed to load question bank.");
+    }
+    load.bank = &bank;
+  }
+
+  load.epoll_fd = epoll_create1(0);
+  if (load.epoll_fd < 0) {
+    failwith("Failed to create epoll instance.");
+  }
+  load.bots = calloc(num_bots, sizeof(struct Bot));
+  if (load.bots == NULL) {
+    failwith("Failed to allocate bots.");
+  }
+  for (int i = 0; i < num_bots; i++) {
+    load.bots[i].id = i;
+    load.bots[i].fd = -1;
+    if (ring_init(&load.bots[i].inbox, INBOX_SIZE) < 0) {
+      failwith("Failed to allocate receive buffer.");
+    }
+  }
+
+  printf("# %d bots -> %s:%d for %.1f s, think %.1f ms, accuracy %d%%\n",
+         num_bots, ip, port, seconds, think_ms, accuracy);
+  run(&load, seconds);
+  report(&load, seconds);
+
+  for (int i = 0; i < num_bots; i++) {
+    ring_free(&load.bots[i].inbox);
+  }
+  free(load.bots);
+  free(load.timers.heap);
+  close(load.epoll_fd);
+  if (load.bank != NULL) {
+    bank_free(load.bank);
+  }
+  return 0;
+}
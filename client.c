@@ -12,25 +12,21 @@
 #include <termios.h>
 #include <unistd.h>
 
+#include "proto.h"
+
 /**
  * DEFINE CONSTANTS
  */
-char *VALID_ARGS[] = {"-i", "-p", "-h", NULL};
+char *VALID_ARGS[] = {"-i", "-p", "-s", "-h", NULL};
 int STRLEN = 1024;
 int DEBUG = 0;
 char *DEFAULT_IP = "127.0.0.1";
-char *SOCK_DELIM = "|";
-char SOCK_END = '\\';
-
-enum Event_Dict {
-  NAME_QUERY,
-  NAME_RETURN,
-  GAME_START,
-  QUESTION_SEND,
-  QUESTION_RESPONSE,
-  ANSWER_BROADCAST,
-  FECKOFF
-};
+#define INBOX_SIZE FRAME_RING
+// session token to resume with (-s), NULL to join as a new player
+char *RESUME_TOKEN = NULL;
+// questions received so far; QUESTION_SEND carries the question's place in
+// the bank, not in this game
+int QUESTIONS_SEEN = 0;
 
 void failwith(char *message) {
   fprintf(stderr, "Error: %s\n", message);
@@ -43,10 +39,12 @@ void failwith(char *message) {
  * @param execname
  */
 void print_help(char *execname) {
-  printf("Usage: %s [-i IP_address] [-p port_number] [-h]\n", execname);
+  printf("Usage: %s [-i IP_address] [-p port_number] [-s token] [-h]\n",
+         execname);
   printf("\n");
   printf("  -i IP_address       Default to \"127.0.0.1\";\n");
   printf("  -p port_number      Default to 25555;\n");
+  printf("  -s token            Rejoin a game after losing the connection;\n");
   printf("  -h                  Display this help info.\n");
 }
 
@@ -83,52 +81,12 @@ void set_raw(int enable) {
   }
 }
 
-/**
- * @brief Split string by delim into string[]
- *
- * @param dest
- * @param str
- * @param delim
- * @return int
- */
-int split_by_delim(char dest[128][1024], char *str, char *delim) {
-  char *src_str = strdup(str); // malloc()
-  char *src_str_saveptr = src_str;
-  char *found;
-
-  int result_pos = 0;
-
-  // string spot
-  while ((found = strsep(&src_str, delim)) != NULL) {
-    strcpy(dest[result_pos], found);
-    result_pos++;
-  }
-
-  free(found);
-  free(src_str_saveptr);
-  return result_pos + 1;
-}
-
-void print_question(char *prompt, char *options[3], int question_number) {
-  printf("Question %d: %s\n", question_number, prompt);
-  printf("Press 1: %s\n", options[0]);
-  printf("Press 2: %s\n", options[1]);
-  printf("Press 3: %s\n", options[2]);
-}
-
-ssize_t swrite(int fd, char *message) {
-  size_t written = 0;
-  size_t length = strlen(message);
-  while (written < length) {
-    ssize_t n = write(fd, message + written, length - written);
-    if (n < 0) {
-      perror("write");
-      return -1;
-    }
-    written += n;
-  }
-
-  return written;
+void print_question(struct Field prompt, struct Field options[3],
+                    int question_number) {
+  printf("Question %d: %.*s\n", question_number, (int)prompt.len, prompt.ptr);
+  printf("Press 1: %.*s\n", (int)options[0].len, options[0].ptr);
+  printf("Press 2: %.*s\n", (int)options[1].len, options[1].ptr);
+  printf("Press 3: %.*s\n", (int)options[2].len, options[2].ptr);
 }
 
 void parse_connect(int argc, char **argv, int *server_fd) {
@@ -177,6 +135,141 @@ void parse_connect(int argc, char **argv, int *server_fd) {
   }
 }
 
+/**
+  Handle one server message
+  payload is a view into the inbox and is tokenized in place
+ */
+void handle_message(int sock_fd, struct RingBuf *inbox, char *payload,
+                    size_t length) {
+  // parse message
+  struct Field args[MAX_FIELDS];
+  int type = parse_message(payload, length, args);
+  if (type < 0) {
+    fprintf(stderr, "Recieved malformed message! %.*s\n", (int)length,
+            payload);
+    return;
+  }
+
+  // handle server communications
+  switch (type) {
+  // name queried from server
+  // scan name and send back with NAME_RETURN
+  case NAME_QUERY: {
+    char command_buffer[1024];
+    char name[128];
+
+    printf("Please type your name: ");
+    scanf("%127s", name);
+
+    int length = frame_printf(command_buffer, 1024, "%d|%s", NAME_RETURN, name);
+    swrite(sock_fd, command_buffer, length);
+  } break;
+
+  // question recieve case. print and wait for input
+  case QUESTION_SEND: {
+    print_question(args[2], &args[3], ++QUESTIONS_SEEN);
+
+    // a frame already buffered (e.g. the answer broadcast arrived in the
+    // same read) means the question is over before we wait on stdin
+    if (ring_has_frame(inbox)) {
+      break;
+    }
+
+    // set up stdio/socket reader (multiplex)
+    int answered = 0;
+    set_raw(1); // set "realtime" mode
+    fd_set readfds;
+    int max_fd = (STDIN_FILENO > sock_fd) ? STDIN_FILENO : sock_fd;
+
+    FD_ZERO(&readfds);
+    FD_SET(STDIN_FILENO, &readfds);
+    FD_SET(sock_fd, &readfds);
+
+    // await input
+    int selecting = select(max_fd + 1, &readfds, NULL, NULL, NULL);
+    if (selecting < 0) {
+      fprintf(stderr, "Selecting failed!\n");
+    }
+
+    if (FD_ISSET(STDIN_FILENO, &readfds)) {
+      // stdin triggered, send message to server
+      char ans;
+      while (!answered) {
+        if (read(STDIN_FILENO, &ans, 1) > 0) {
+          answered = 1;
+          set_raw(0);
+          break;
+        }
+      }
+
+      // send response to server
+      char res_buffer[1024];
+      int length =
+          frame_printf(res_buffer, 1024, "%d|%c", QUESTION_RESPONSE, ans);
+      swrite(sock_fd, res_buffer, length);
+
+      if (DEBUG) {
+        printf("[DEBUG]: Answer %s\n", res_buffer + FRAME_HEADER);
+      }
+    } else {
+      // socket triggered. print answer
+      set_raw(0);
+    }
+  } break;
+
+  // answer broadcase - print
+  case ANSWER_BROADCAST: {
+    // answered = 1;
+    printf("%.*s\n", (int)args[1].len, args[1].ptr);
+  } break;
+
+  // standings after a question: our rank plus changed top slots
+  case LEADERBOARD: {
+    printf("You are #%d with %d points.\n", field_int(args[1]),
+           field_int(args[2]));
+
+    struct Field slots[MAX_FIELDS];
+    char *cursor = args[3].ptr;
+    size_t left = args[3].len;
+    while (left > 0) {
+      char *comma = memchr(cursor, ',', left);
+      size_t slot_len = comma != NULL ? (size_t)(comma - cursor) : left;
+      int count = tokenize(cursor, slot_len, ':', slots, 3);
+      if (count == 3) {
+        printf("  #%d %.*s (%d)\n", field_int(slots[0]), (int)slots[2].len,
+               slots[2].ptr, field_int(slots[1]));
+      }
+      if (comma == NULL) {
+        break;
+      }
+      left -= slot_len + 1;
+      cursor = comma + 1;
+    }
+  } break;
+
+  // session token, or our place in the game after a resume
+  case SESSION: {
+    if (args[1].len == 0) {
+      printf("Could not resume, joining as a new player.\n");
+    } else if (RESUME_TOKEN != NULL) {
+      QUESTIONS_SEEN = field_int(args[2]);
+      printf("Resumed after question %d with %d points (#%d).\n",
+             field_int(args[2]), field_int(args[3]), field_int(args[4]));
+    } else {
+      printf("Session %.*s (rejoin with -s if you lose the connection)\n",
+             (int)args[1].len, args[1].ptr);
+    }
+  } break;
+
+  // exit case
+  case FECKOFF: {
+    shutdown(sock_fd, SHUT_RDWR);
+    close(sock_fd);
+    exit(0);
+  } break;
+  }
+}
+
 int main(int argc, char **argv) {
   int help = 0;
 
@@ -195,6 +288,13 @@ int main(int argc, char **argv) {
       // defer to parse_connect
     }
 
+    else if (strcmp(arg, "-s") == 0) {
+      if (i + 1 >= argc) {
+        failwith("-s expects a session token");
+      }
+      RESUME_TOKEN = argv[++i];
+    }
+
     // invalid argument
     else if (arg[0] == '-') {
       fprintf(stderr, "Error: Unknown option '%s' recieved.\n", arg);
@@ -211,120 +311,44 @@ int main(int argc, char **argv) {
   int sock_fd;
   parse_connect(argc, argv, &sock_fd);
 
-  // socket I/O
-  char buffer[1024];
-  memset(buffer, 0, sizeof(buffer));
-  while (1) {
-    int n;
-    while (buffer[strlen(buffer) - 1] != SOCK_END) {
-      int amount = read(sock_fd, buffer, 1024);
-      if (amount < 1) {
-        // server closed
-        close(sock_fd);
-        exit(0);
-      } else {
-        n += amount;
-      }
-    }
-    if (DEBUG) {
-      printf("[DEBUG]: recieve:: %s\n", buffer);
-    }
-
-    // trim delimiter from buffer
-    buffer[strlen(buffer) - 1] = 0;
+  // socket I/O: reassemble frames from the ring and handle each in order
+  struct RingBuf inbox;
+  if (ring_init(&inbox, INBOX_SIZE) < 0) {
+    failwith("Failed to allocate receive buffer.");
+  }
+  char scratch[FRAME_MAX];
+
+  // a reconnect asks for its old seat before anything else
+  if (RESUME_TOKEN != NULL) {
+    char frame[64];
+    int length = frame_printf(frame, sizeof(frame), "%d|%s", RESUME,
+                              RESUME_TOKEN);
+    swrite(sock_fd, frame, length);
+  }
 
-    // socket close
-    if (n == 0) {
+  while (1) {
+    ssize_t amount = ring_fill(&inbox, sock_fd, 0);
+    if (amount < 1) {
+      // server closed
       printf("socket closed.\n");
       close(sock_fd);
       exit(0);
     }
 
-    // parse message
-    char args[128][1024];
-    int arg_num = split_by_delim(args, buffer, SOCK_DELIM);
-    if (arg_num < 1) {
-      fprintf(stderr, "Recieved no arguments! %s\n", buffer);
-    }
-
-    // handle server communications
-    switch (atoi(args[0])) {
-    // name queried from server
-    // scan name and send back with NAME_RETURN
-    case NAME_QUERY: {
-      char command_buffer[1024];
-      char name[128];
-
-      printf("Please type your name: ");
-      scanf("%s", name);
-
-      snprintf(command_buffer, 1024, "%d|%s\\", NAME_RETURN, name);
-      write(sock_fd, command_buffer, 1024);
-    } break;
-
-    // question recieve case. print and wait for input
-    case QUESTION_SEND: {
-      int question_number = atoi(args[1]);
-      char *prompt = args[2];
-      char *options[3] = {args[3], args[4], args[5]};
-      print_question(prompt, options, question_number + 1);
-
-      // set up stdio/socket reader (multiplex)
-      int answered = 0;
-      set_raw(1); // set "realtime" mode
-      fd_set readfds;
-      int max_fd = (STDIN_FILENO > sock_fd) ? STDIN_FILENO : sock_fd;
-
-      FD_ZERO(&readfds);
-      FD_SET(STDIN_FILENO, &readfds);
-      FD_SET(sock_fd, &readfds);
-
-      // await input
-      int selecting = select(max_fd + 1, &readfds, NULL, NULL, NULL);
-      if (selecting < 0) {
-        fprintf(stderr, "Selecting failed!\n");
-      }
-
-      if (FD_ISSET(STDIN_FILENO, &readfds)) {
-        // stdin triggered, send message to server
-        char ans;
-        while (!answered) {
-          if (read(STDIN_FILENO, &ans, 1) > 0) {
-            answered = 1;
-            set_raw(0);
-            break;
-          }
-        }
-
-        // send response to server
-        char res_buffer[1024];
-        snprintf(res_buffer, 1024, "%d|%c\\", QUESTION_RESPONSE, ans);
-        swrite(sock_fd, res_buffer);
-
-        if (DEBUG) {
-          printf("[DEBUG]: Answer %s\n", res_buffer);
-        }
-      } else {
-        // socket triggered. print answer
-        set_raw(0);
+    char *payload;
+    size_t payload_len;
+    int status;
+    while ((status = ring_next_frame(&inbox, scratch, &payload,
+                                     &payload_len)) == 1) {
+      if (DEBUG) {
+        printf("[DEBUG]: recieve:: %.*s\n", (int)payload_len, payload);
       }
-    } break;
-
-    // answer broadcase - print
-    case ANSWER_BROADCAST: {
-      // answered = 1;
-      printf("%s\n", args[1]);
-    } break;
-
-    // exit case
-    case FECKOFF: {
-      shutdown(sock_fd, SHUT_RDWR);
-      close(sock_fd);
-      exit(0);
-    } break;
+      handle_message(sock_fd, &inbox, payload, payload_len);
     }
 
-    memset(buffer, 0, sizeof(buffer));
+    if (status < 0) {
+      failwith("Recieved oversized frame from server.");
+    }
   }
 
   return 0;
@@ -0,0 +1,83 @@
+/**
+  Latency histogram
+*/
+
+#include "hist.h"
+
+#include <string.h>
+
+void hist_init(struct Histogram *hist) { memset(hist, 0, sizeof(*hist)); }
+
+/**
+ * @brief Bucket index of a value
+ * values below HIST_SUB_BUCKETS get a bucket each, larger values keep
+ * their top HIST_SUB_BITS bits below the leading one
+ */
+static int bucket_of(uint64_t value) {
+  if (value < HIST_SUB_BUCKETS) {
+    return (int)value;
+  }
+  int exponent = 63 - __builtin_clzll(value);
+  int sub = (value >> (exponent - HIST_SUB_BITS)) & (HIST_SUB_BUCKETS - 1);
+  return (exponent - HIST_SUB_BITS + 1) * HIST_SUB_BUCKETS + sub;
+}
+
+/**
+ * @brief Largest value that falls in a bucket
+ */
+static uint64_t bucket_limit(int bucket) {
+  if (bucket < HIST_SUB_BUCKETS) {
+    return bucket;
+  }
+  int exponent = bucket / HIST_SUB_BUCKETS + HIST_SUB_BITS - 1;
+  uint64_t sub = bucket % HIST_SUB_BUCKETS;
+  uint64_t step = 1ULL << (exponent - HIST_SUB_BITS);
+  return (1ULL << exponent) + (sub + 1) * step - 1;
+}
+
+void hist_record(struct Histogram *hist, uint64_t value) {
+  hist->buckets[bucket_of(value)]++;
+  hist->count++;
+  hist->sum += value;
+  if (value > hist->max) {
+    hist->max = value;
+  }
+}
+
+void hist_merge(struct Histogram *dest, const struct Histogram *src) {
+  for (int i = 0; i < HIST_BUCKETS; i++) {
+    dest->buckets[i] += src->buckets[i];
+  }
+  dest->count += src->count;
+  dest->sum += src->sum;
+  if (src->max > dest->max) {
+    dest->max = src->max;
+  }
+}
+
+/**
+ * @brief Value at or below which `percentile` (0-100) of samples fall
+ * reported as the upper edge of its bucket, capped at the largest sample
+ * @param hist
+ * @param percentile
+ * @return uint64_t 0 for an empty histogram
+ */
+uint64_t hist_percentile(const struct Histogram *hist, double percentile) {
+  if (hist->count == 0) {
+    return 0;
+  }
+  uint64_t rank = (uint64_t)(hist->count * percentile / 100.0 + 0.5);
+  if (rank < 1) {
+    rank = 1;
+  }
+
+  uint64_t seen = 0;
+  for (int i = 0; i < HIST_BUCKETS; i++) {
+    seen += hist->buckets[i];
+    if (seen >= rank) {
+      uint64_t limit = bucket_limit(i);
+      return limit < hist->max ? limit : hist->max;
+    }
+  }
+  return hist->max;
+}
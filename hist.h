@@ -0,0 +1,31 @@
+/**
+  Latency histogram
+
+  Log-linear buckets: every power of two is split into HIST_SUB_BUCKETS
+  equal steps, so any recorded value is reported within ~6% while the
+  whole range of a uint64_t fits in a fixed array. Recording is a couple
+  of shifts and an increment, cheap enough for every message.
+*/
+
+#ifndef HIST_H
+#define HIST_H
+
+#include <stdint.h>
+
+#define HIST_SUB_BITS 4
+#define HIST_SUB_BUCKETS (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS ((64 - HIST_SUB_BITS + 1) * HIST_SUB_BUCKETS)
+
+struct Histogram {
+  uint64_t count;
+  uint64_t sum;
+  uint64_t max;
+  uint64_t buckets[HIST_BUCKETS];
+};
+
+void hist_init(struct Histogram *hist);
+void hist_record(struct Histogram *hist, uint64_t value);
+void hist_merge(struct Histogram *dest, const struct Histogram *src);
+uint64_t hist_percentile(const struct Histogram *hist, double percentile);
+
+#endif
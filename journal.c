@@ -0,0 +1,312 @@
+/**
+  Score journal
+*/
+
+#include "journal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @brief Write all of buf, retrying short writes
+ * @return int 0 on success, -1 on error (errno set)
+ */
+static int write_all(int fd, const char *buf, size_t len) {
+  while (len > 0) {
+    ssize_t n = write(fd, buf, len);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    buf += n;
+    len -= n;
+  }
+  return 0;
+}
+
+/**
+ * @brief 0 if header starts a journal this build can read
+ */
+int journal_check_header(const struct JournalHeader *header) {
+  if (memcmp(header->magic, JOURNAL_MAGIC, sizeof(header->magic)) != 0 ||
+      header->version != JOURNAL_VERSION) {
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Size of the complete record at data
+ * @param data
+ * @param avail bytes left in the journal from data on
+ * @return size_t 0 if the record is torn or not a record
+ */
+size_t journal_record_size(const char *data, size_t avail) {
+  struct JournalRecord record;
+  if (avail < sizeof(record)) {
+    return 0;
+  }
+  memcpy(&record, data, sizeof(record));
+  if (record.size < sizeof(record) ||
+      record.size > sizeof(record) + JOURNAL_NAME_MAX ||
+      record.size > avail || record.type > JOURNAL_END) {
+    return 0;
+  }
+  return record.size;
+}
+
+/**
+ * @brief Check an existing journal and cut off a torn record left at its
+ * end by an interrupted write, so new records follow a complete one
+ * @return int 0 on success, -1 on error (reported)
+ */
+static int recover(int fd, const char *path, size_t file_size) {
+  char *data = mmap(NULL, file_size, PROT_READ, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED) {
+    perror(path);
+    return -1;
+  }
+  if (file_size < sizeof(struct JournalHeader) ||
+      journal_check_header((struct JournalHeader *)data) < 0) {
+    fprintf(stderr, "%s is not a journal (or an unsupported version).\n",
+            path);
+    munmap(data, file_size);
+    return -1;
+  }
+
+  size_t end = sizeof(struct JournalHeader);
+  size_t size;
+  while ((size = journal_record_size(data + end, file_size - end)) > 0) {
+    end += size;
+  }
+  munmap(data, file_size);
+  if (end < file_size) {
+    fprintf(stderr, "%s: dropping %zu bytes of torn record.\n", path,
+            file_size - end);
+    if (ftruncate(fd, end) < 0) {
+      perror(path);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief Add time_ms to an absolute CLOCK_REALTIME time
+ */
+static void add_ms(struct timespec *ts, long long time_ms) {
+  ts->tv_sec += time_ms / 1000;
+  ts->tv_nsec += (time_ms % 1000) * 1000000;
+  if (ts->tv_nsec >= 1000000000) {
+    ts->tv_sec++;
+    ts->tv_nsec -= 1000000000;
+  }
+}
+
+/**
+ * @brief Commit thread: waits for records, gives later ones up to
+ * interval_ms to join the group, then writes and syncs the whole group
+ * @param arg struct Journal
+ */
+static void *journal_handler(void *arg) {
+  struct Journal *journal = arg;
+
+  pthread_mutex_lock(&journal->lock);
+  for (;;) {
+    while (journal->fill_len == 0 && !journal->closing) {
+      pthread_cond_wait(&journal->wake, &journal->lock);
+    }
+    if (journal->fill_len == 0) {
+      break;
+    }
+
+    // the group closes at the interval, or early once the buffer is half
+    // full so appenders do not have to wait for room
+    if (journal->interval_ms > 0) {
+      struct timespec deadline;
+      clock_gettime(CLOCK_REALTIME, &deadline);
+      add_ms(&deadline, journal->interval_ms);
+      while (!journal->closing &&
+             journal->fill_len < journal->capacity / 2 &&
+             pthread_cond_timedwait(&journal->wake, &journal->lock,
+                                    &deadline) != ETIMEDOUT) {
+      }
+    }
+
+    char *group = journal->fill;
+    size_t len = journal->fill_len;
+    journal->fill = journal->flush;
+    journal->fill_len = 0;
+    journal->flush = group;
+    pthread_cond_broadcast(&journal->drained);
+    pthread_mutex_unlock(&journal->lock);
+
+    int ok = write_all(journal->fd, group, len) == 0 &&
+             fdatasync(journal->fd) == 0;
+    if (!ok) {
+      perror("journal");
+    }
+
+    pthread_mutex_lock(&journal->lock);
+    journal->commits++;
+    journal->failed |= !ok;
+  }
+  // appenders still waiting for room give up now
+  pthread_cond_broadcast(&journal->drained);
+  pthread_mutex_unlock(&journal->lock);
+  return NULL;
+}
+
+/**
+ * @brief Open (or create) a journal for appending and start its commit
+ * thread. A new run is marked with a JOURNAL_OPEN record.
+ * @param journal
+ * @param path
+ * @param interval_ms longest a record waits for its group to be committed,
+ * 0 commits as soon as the previous commit finished
+ * @param capacity bytes buffered per group (two buffers are allocated)
+ * @return int 0 on success, -1 on error (reported)
+ */
+int journal_open(struct Journal *journal, const char *path,
+                 long long interval_ms, size_t capacity) {
+  memset(journal, 0, sizeof(*journal));
+  journal->fd = open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+  if (journal->fd < 0) {
+    perror(path);
+    return -1;
+  }
+
+  // new files get a header, existing ones must be journals
+  struct stat st;
+  if (fstat(journal->fd, &st) < 0) {
+    perror(path);
+    close(journal->fd);
+    return -1;
+  }
+  if (st.st_size == 0) {
+    struct JournalHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, JOURNAL_MAGIC, sizeof(header.magic));
+    header.version = JOURNAL_VERSION;
+    if (write_all(journal->fd, (char *)&header, sizeof(header)) < 0) {
+      perror(path);
+      close(journal->fd);
+      return -1;
+    }
+  } else if (recover(journal->fd, path, st.st_size) < 0) {
+    close(journal->fd);
+    return -1;
+  }
+
+  journal->capacity = capacity;
+  journal->interval_ms = interval_ms;
+  journal->fill = malloc(capacity);
+  journal->flush = malloc(capacity);
+  if (journal->fill == NULL || journal->flush == NULL) {
+    fprintf(stderr, "Failed to allocate journal buffers.\n");
+    free(journal->fill);
+    free(journal->flush);
+    close(journal->fd);
+    return -1;
+  }
+  pthread_mutex_init(&journal->lock, NULL);
+  pthread_cond_init(&journal->wake, NULL);
+  pthread_cond_init(&journal->drained, NULL);
+
+  struct JournalRecord record;
+  memset(&record, 0, sizeof(record));
+  record.type = JOURNAL_OPEN;
+  journal_append(journal, &record, NULL, 0);
+
+  if (pthread_create(&journal->thread, NULL, journal_handler, journal) != 0) {
+    fprintf(stderr, "Failed to start journal thread.\n");
+    free(journal->fill);
+    free(journal->flush);
+    close(journal->fd);
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Queue a record for the next group commit
+ * fills in size and time_ns. Only waits when the commit thread is a whole
+ * buffer behind.
+ * @param journal
+ * @param record
+ * @param name trailing name (JOURNAL_PLAYER), may be NULL
+ * @param name_len truncated to JOURNAL_NAME_MAX
+ * @return int 0 if queued, -1 if dropped because a commit failed or the
+ * journal is closing
+ */
+int journal_append(struct Journal *journal, struct JournalRecord *record,
+                   const char *name, size_t name_len) {
+  if (name_len > JOURNAL_NAME_MAX) {
+    name_len = JOURNAL_NAME_MAX;
+  }
+  size_t size = sizeof(*record) + name_len;
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  record->size = size;
+  record->time_ns = (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+
+  pthread_mutex_lock(&journal->lock);
+  if (journal->fill_len + size > journal->capacity && !journal->closing) {
+    journal->stalls++;
+    while (journal->fill_len + size > journal->capacity &&
+           !journal->closing) {
+      pthread_cond_signal(&journal->wake);
+      pthread_cond_wait(&journal->drained, &journal->lock);
+    }
+  }
+  if (journal->failed || journal->closing) {
+    journal->dropped++;
+    pthread_mutex_unlock(&journal->lock);
+    return -1;
+  }
+  if (journal->fill_len == 0 ||
+      journal->fill_len + size >= journal->capacity / 2) {
+    pthread_cond_signal(&journal->wake);
+  }
+  memcpy(journal->fill + journal->fill_len, record, sizeof(*record));
+  if (name_len > 0) {
+    memcpy(journal->fill + journal->fill_len + sizeof(*record), name,
+           name_len);
+  }
+  journal->fill_len += size;
+  journal->records++;
+  pthread_mutex_unlock(&journal->lock);
+  return 0;
+}
+
+/**
+ * @brief Commit everything appended so far, stop the commit thread and
+ * close the file
+ * other threads may keep appending: their records are dropped from here
+ * on, so the lock stays usable until the process exits
+ * @param journal
+ */
+void journal_close(struct Journal *journal) {
+  pthread_mutex_lock(&journal->lock);
+  journal->closing = 1;
+  pthread_cond_signal(&journal->wake);
+  pthread_mutex_unlock(&journal->lock);
+  pthread_join(journal->thread, NULL);
+
+  pthread_mutex_lock(&journal->lock);
+  close(journal->fd);
+  journal->fd = -1;
+  free(journal->fill);
+  free(journal->flush);
+  journal->fill = journal->flush = NULL;
+  pthread_mutex_unlock(&journal->lock);
+}
@@ -0,0 +1,92 @@
+/**
+  Score journal
+
+  Every game event that moves a score is appended to one binary journal
+  file so standings can be rebuilt (audits, payouts) after the server is
+  gone. Workers only copy the record into an in-memory buffer; a commit
+  thread writes whatever accumulated and fdatasyncs it as one group, so
+  no fsync ever sits on the answer path. A record reaches the disk at
+  most one commit interval (plus the write itself) after it was appended;
+  a crash loses at most that window, never an earlier record. Closing the
+  journal commits everything appended before it.
+
+  File layout (host byte order):
+  header | record | record | ...
+  Each record is a struct JournalRecord followed by `size - sizeof(struct
+  JournalRecord)` bytes of player name (JOURNAL_PLAYER only, not NUL
+  terminated). A run of the server starts with a JOURNAL_OPEN record, so
+  room ids only need to be unique within a run. A torn record at the end
+  of the file is what an interrupted write leaves and readers ignore it.
+*/
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define JOURNAL_MAGIC "TRIVJRNL"
+#define JOURNAL_VERSION 2
+#define JOURNAL_NAME_MAX 255
+
+struct JournalHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+};
+
+enum Journal_Event {
+  JOURNAL_OPEN,   // server started
+  JOURNAL_START,  // game started: seat = players, question = questions,
+                  // seed = the room's question order
+  JOURNAL_PLAYER, // player in seat registered as the trailing name
+  JOURNAL_ANSWER, // player in seat answered question (bank entry) with
+                  // choice
+  JOURNAL_END,    // room closed: seat = winner (-1 if none), question =
+                  // questions asked
+};
+
+struct JournalRecord {
+  uint16_t size; // bytes, name included
+  uint16_t type;
+  uint32_t room;
+  int64_t time_ns; // wall clock
+  int32_t seat;
+  int32_t question;
+  int32_t choice; // 1-based option picked
+  int32_t delta;
+  int32_t score; // seat's score after this record
+  int32_t entry; // bank index of the question
+  uint64_t seed;
+};
+
+struct Journal {
+  int fd;
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t wake;    // records pending or closing
+  pthread_cond_t drained; // a commit made room in the buffer
+  char *fill;             // appenders copy into this buffer
+  size_t fill_len;
+  char *flush; // the commit thread writes this one
+  size_t capacity;
+  long long interval_ms;
+  int closing;
+  // stats, read under the lock
+  uint64_t records;
+  uint64_t commits;
+  uint64_t stalls; // appends that waited for a commit to make room
+  uint64_t dropped; // appends refused after a failure or close
+  int failed;       // a write or sync failed, later records are dropped
+};
+
+int journal_open(struct Journal *journal, const char *path,
+                 long long interval_ms, size_t capacity);
+int journal_append(struct Journal *journal, struct JournalRecord *record,
+                   const char *name, size_t name_len);
+void journal_close(struct Journal *journal);
+int journal_check_header(const struct JournalHeader *header);
+size_t journal_record_size(const char *data, size_t avail);
+
+#endif
@@ -0,0 +1,246 @@
+/**
+  Order-statistics leaderboard
+*/
+
+#include "leaderboard.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static int bucket_of(struct Leaderboard *board, int score) {
+  return board->max_score - score;
+}
+
+static int in_range(struct Leaderboard *board, int score) {
+  int bucket = bucket_of(board, score);
+  return bucket >= 0 && bucket < board->num_buckets;
+}
+
+static void tree_add(struct Leaderboard *board, int bucket, int delta) {
+  for (int i = bucket + 1; i <= board->num_buckets; i += i & -i) {
+    board->tree[i] += delta;
+  }
+}
+
+/**
+ * @brief Players in buckets [0, bucket)
+ */
+static int tree_prefix(struct Leaderboard *board, int bucket) {
+  int sum = 0;
+  for (int i = bucket; i > 0; i -= i & -i) {
+    sum += board->tree[i];
+  }
+  return sum;
+}
+
+/**
+ * @brief First bucket whose running count exceeds `seen`
+ * i.e. the bucket holding the (seen + 1)th best player
+ */
+static int tree_search(struct Leaderboard *board, int seen) {
+  int pos = 0;
+  int step = 1;
+  while (step * 2 <= board->num_buckets) {
+    step *= 2;
+  }
+  for (; step > 0; step /= 2) {
+    if (pos + step <= board->num_buckets && board->tree[pos + step] <= seen) {
+      pos += step;
+      seen -= board->tree[pos];
+    }
+  }
+  return pos;
+}
+
+/**
+ * @brief (Re)allocate the score buckets for [-range, range], all empty
+ * @return int 0 on success, -1 on allocation failure
+ */
+static int alloc_buckets(struct Leaderboard *board, int range) {
+  int num_buckets = range * 2 + 1;
+  int *tree = calloc(num_buckets + 1, sizeof(int));
+  int *heads = malloc(sizeof(int) * num_buckets);
+  int *tails = malloc(sizeof(int) * num_buckets);
+  if (tree == NULL || heads == NULL || tails == NULL) {
+    free(tree);
+    free(heads);
+    free(tails);
+    return -1;
+  }
+  memset(heads, -1, sizeof(int) * num_buckets);
+  memset(tails, -1, sizeof(int) * num_buckets);
+
+  free(board->tree);
+  free(board->heads);
+  free(board->tails);
+  board->tree = tree;
+  board->heads = heads;
+  board->tails = tails;
+  board->max_score = range;
+  board->num_buckets = num_buckets;
+  return 0;
+}
+
+/**
+ * @brief Allocate an empty board for player ids [0, num_players)
+ * @return int 0 on success, -1 on allocation failure
+ */
+int leaderboard_init(struct Leaderboard *board, int num_players) {
+  memset(board, 0, sizeof(*board));
+  board->num_players = num_players;
+  board->next = malloc(sizeof(int) * num_players);
+  board->prev = malloc(sizeof(int) * num_players);
+  board->score = calloc(num_players, sizeof(int));
+  board->ranked = calloc(num_players, sizeof(int));
+  if (board->next == NULL || board->prev == NULL || board->score == NULL ||
+      board->ranked == NULL || alloc_buckets(board, LEADERBOARD_RANGE) < 0) {
+    leaderboard_free(board);
+    return -1;
+  }
+  return 0;
+}
+
+void leaderboard_free(struct Leaderboard *board) {
+  free(board->tree);
+  free(board->heads);
+  free(board->tails);
+  free(board->next);
+  free(board->prev);
+  free(board->score);
+  free(board->ranked);
+  memset(board, 0, sizeof(*board));
+}
+
+/**
+ * @brief Append a player to its score's bucket
+ * players reaching a score later rank after those already on it
+ */
+static void link_player(struct Leaderboard *board, int player) {
+  int bucket = bucket_of(board, board->score[player]);
+  board->next[player] = -1;
+  board->prev[player] = board->tails[bucket];
+  if (board->tails[bucket] != -1) {
+    board->next[board->tails[bucket]] = player;
+  } else {
+    board->heads[bucket] = player;
+  }
+  board->tails[bucket] = player;
+  tree_add(board, bucket, 1);
+}
+
+static void unlink_player(struct Leaderboard *board, int player) {
+  int bucket = bucket_of(board, board->score[player]);
+  if (board->prev[player] != -1) {
+    board->next[board->prev[player]] = board->next[player];
+  } else {
+    board->heads[bucket] = board->next[player];
+  }
+  if (board->next[player] != -1) {
+    board->prev[board->next[player]] = board->prev[player];
+  } else {
+    board->tails[bucket] = board->prev[player];
+  }
+  tree_add(board, bucket, -1);
+}
+
+/**
+ * @brief Put a player on the board with its current score
+ */
+void leaderboard_add(struct Leaderboard *board, int player) {
+  if (board->ranked[player]) {
+    return;
+  }
+  link_player(board, player);
+  board->ranked[player] = 1;
+  board->count++;
+}
+
+/**
+ * @brief Take a player off the board (e.g. it disconnected)
+ */
+void leaderboard_remove(struct Leaderboard *board, int player) {
+  if (!board->ranked[player]) {
+    return;
+  }
+  unlink_player(board, player);
+  board->ranked[player] = 0;
+  board->count--;
+}
+
+/**
+ * @brief Double the score range until `score` fits, keeping the order
+ * @return int 0 on success, -1 on allocation failure
+ */
+static int grow(struct Leaderboard *board, int score) {
+  int *order = malloc(sizeof(int) * (board->count ? board->count : 1));
+  if (order == NULL) {
+    return -1;
+  }
+  int count = leaderboard_top(board, board->count, order);
+
+  int range = board->max_score;
+  while (range < abs(score)) {
+    range *= 2;
+  }
+  if (alloc_buckets(board, range) < 0) {
+    free(order);
+    return -1;
+  }
+  for (int i = 0; i < count; i++) {
+    link_player(board, order[i]);
+  }
+  free(order);
+  return 0;
+}
+
+/**
+ * @brief Change a player's score by delta, O(log S)
+ * @return int 0 on success, -1 if the board could not grow to fit it
+ */
+int leaderboard_update(struct Leaderboard *board, int player, int delta) {
+  if (delta == 0) {
+    return 0;
+  }
+  int score = board->score[player] + delta;
+  if (!in_range(board, score) && grow(board, score) < 0) {
+    return -1;
+  }
+  if (!board->ranked[player]) {
+    board->score[player] = score;
+    return 0;
+  }
+  unlink_player(board, player);
+  board->score[player] = score;
+  link_player(board, player);
+  return 0;
+}
+
+/**
+ * @brief 1-based rank of a player, ties share the better rank
+ * @return int 0 if the player is not on the board
+ */
+int leaderboard_rank(struct Leaderboard *board, int player) {
+  if (!board->ranked[player]) {
+    return 0;
+  }
+  return tree_prefix(board, bucket_of(board, board->score[player])) + 1;
+}
+
+/**
+ * @brief Best k players, best first
+ * @param board
+ * @param k
+ * @param players filled with up to k player ids
+ * @return int number of players written
+ */
+int leaderboard_top(struct Leaderboard *board, int k, int *players) {
+  int found = 0;
+  while (found < k && found < board->count) {
+    int bucket = tree_search(board, found);
+    for (int player = board->heads[bucket]; player != -1 && found < k;
+         player = board->next[player]) {
+      players[found++] = player;
+    }
+  }
+  return found;
+}
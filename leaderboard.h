@@ -0,0 +1,40 @@
+/**
+  Order-statistics leaderboard
+
+  Players are bucketed by score. A Fenwick tree over the bucket counts
+  answers "how many players score higher" in O(log S) (S = number of
+  possible scores), which gives rank-of-player, and each bucket keeps a
+  list of its players so top-K walks only the buckets it reports.
+  Updating a score is O(log S). The score range starts small and doubles
+  (rebuilding the board) whenever a score falls outside it.
+*/
+
+#ifndef LEADERBOARD_H
+#define LEADERBOARD_H
+
+// initial score range is [-LEADERBOARD_RANGE, LEADERBOARD_RANGE]
+#define LEADERBOARD_RANGE 32
+
+struct Leaderboard {
+  int max_score;
+  int num_buckets; // scores max_score down to max_score - num_buckets + 1
+  int *tree;       // Fenwick tree of bucket counts, bucket 0 = best
+  int *heads;      // first player of each bucket, -1 if empty
+  int *tails;
+  int *next; // per player
+  int *prev;
+  int *score;
+  int *ranked; // 1 if the player is on the board
+  int num_players;
+  int count; // players on the board
+};
+
+int leaderboard_init(struct Leaderboard *board, int num_players);
+void leaderboard_free(struct Leaderboard *board);
+void leaderboard_add(struct Leaderboard *board, int player);
+void leaderboard_remove(struct Leaderboard *board, int player);
+int leaderboard_update(struct Leaderboard *board, int player, int delta);
+int leaderboard_rank(struct Leaderboard *board, int player);
+int leaderboard_top(struct Leaderboard *board, int k, int *players);
+
+#endif
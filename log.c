@@ -0,0 +1,256 @@
+/**
+  Asynchronous logging
+*/
+
+#include "log.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LOG_BUFFER (64 * 1024)
+
+int LogLevel = LOG_INFO;
+
+static struct LogRing *Rings[LOG_MAX_THREADS];
+static int NumRings; // atomic, slots claimed (a ring may not be stored yet)
+static __thread struct LogRing *ThreadRing;
+static __thread int ThreadUnregistered; // no ring left for this thread
+
+static int Started; // atomic
+static int OutFd = 1;
+static int ErrFd = 2;
+static pthread_t Writer;
+// held by whoever drains the rings: the writer, or log_flush at exit
+static pthread_mutex_t DrainLock = PTHREAD_MUTEX_INITIALIZER;
+
+struct Output {
+  int fd;
+  size_t used;
+  char data[LOG_BUFFER];
+};
+
+static struct Output Out;
+static struct Output Err;
+
+static int64_t now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief Write all of buf, retrying short writes
+ * errors are ignored, there is nowhere left to report them
+ */
+static void write_all(int fd, const char *buf, size_t len) {
+  while (len > 0) {
+    ssize_t n = write(fd, buf, len);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    buf += n;
+    len -= n;
+  }
+}
+
+static void output_flush(struct Output *output) {
+  write_all(output->fd, output->data, output->used);
+  output->used = 0;
+}
+
+static void output_put(struct Output *output, const char *text, size_t len) {
+  if (output->used + len > sizeof(output->data)) {
+    output_flush(output);
+  }
+  memcpy(output->data + output->used, text, len);
+  output->used += len;
+}
+
+/**
+ * @brief The calling thread's ring, claimed the first time it logs
+ * @return struct LogRing* NULL if there is none for this thread
+ */
+static struct LogRing *thread_ring() {
+  if (ThreadRing != NULL || ThreadUnregistered) {
+    return ThreadRing;
+  }
+  ThreadUnregistered = 1;
+  struct LogRing *ring = calloc(1, sizeof(struct LogRing));
+  if (ring == NULL) {
+    return NULL;
+  }
+  int slot = __atomic_fetch_add(&NumRings, 1, __ATOMIC_RELAXED);
+  if (slot >= LOG_MAX_THREADS) {
+    free(ring);
+    return NULL;
+  }
+  __atomic_store_n(&Rings[slot], ring, __ATOMIC_RELEASE);
+  ThreadRing = ring;
+  return ring;
+}
+
+/**
+ * @brief Format a message into the next slot of the calling thread's ring
+ * messages below LogLevel are skipped. Safe from any thread.
+ * @param level
+ * @param format printf format, the message ends with its own newline
+ */
+void log_printf(int level, const char *format, ...) {
+  if (level > __atomic_load_n(&LogLevel, __ATOMIC_RELAXED)) {
+    return;
+  }
+
+  struct LogRing *ring = NULL;
+  if (__atomic_load_n(&Started, __ATOMIC_ACQUIRE)) {
+    ring = thread_ring();
+  }
+  struct LogRecord local;
+  struct LogRecord *record = &local;
+  if (ring != NULL) {
+    uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    if (ring->tail - head == LOG_RING_SLOTS) {
+      __atomic_store_n(&ring->dropped, ring->dropped + 1, __ATOMIC_RELAXED);
+      return;
+    }
+    record = &ring->slots[ring->tail & (LOG_RING_SLOTS - 1)];
+  }
+
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(record->text, sizeof(record->text), format, args);
+  va_end(args);
+  if (n < 0) {
+    return;
+  }
+  if (n >= (int)sizeof(record->text)) {
+    n = sizeof(record->text) - 1;
+    record->text[n - 1] = '\n';
+  }
+  record->length = n;
+  record->level = level;
+
+  if (ring == NULL) {
+    write_all(level == LOG_ERROR ? ErrFd : OutFd, record->text, n);
+    return;
+  }
+  record->time_ns = now_ns();
+  __atomic_store_n(&ring->tail, ring->tail + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Write out every record logged so far, oldest first
+ * the caller holds DrainLock
+ * @return int records written
+ */
+static int drain() {
+  struct LogRing *rings[LOG_MAX_THREADS];
+  uint64_t tails[LOG_MAX_THREADS];
+  int count = __atomic_load_n(&NumRings, __ATOMIC_RELAXED);
+  if (count > LOG_MAX_THREADS) {
+    count = LOG_MAX_THREADS;
+  }
+  int num_rings = 0;
+  for (int i = 0; i < count; i++) {
+    struct LogRing *ring = __atomic_load_n(&Rings[i], __ATOMIC_ACQUIRE);
+    if (ring == NULL) {
+      continue;
+    }
+    uint64_t dropped = __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+    if (dropped != ring->reported) {
+      char note[64];
+      int n = snprintf(note, sizeof(note), "[log] %llu messages dropped\n",
+                       (unsigned long long)(dropped - ring->reported));
+      output_put(&Err, note, n);
+      ring->reported = dropped;
+    }
+    rings[num_rings] = ring;
+    tails[num_rings++] = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+  }
+
+  // merge the rings by time, each one is already in order
+  int written = 0;
+  for (;;) {
+    int oldest = -1;
+    struct LogRecord *record = NULL;
+    for (int i = 0; i < num_rings; i++) {
+      if (rings[i]->head == tails[i]) {
+        continue;
+      }
+      struct LogRecord *next =
+          &rings[i]->slots[rings[i]->head & (LOG_RING_SLOTS - 1)];
+      if (record == NULL || next->time_ns < record->time_ns) {
+        oldest = i;
+        record = next;
+      }
+    }
+    if (record == NULL) {
+      break;
+    }
+    output_put(record->level == LOG_ERROR ? &Err : &Out, record->text,
+               record->length);
+    __atomic_store_n(&rings[oldest]->head, rings[oldest]->head + 1,
+                     __ATOMIC_RELEASE);
+    written++;
+  }
+  output_flush(&Out);
+  output_flush(&Err);
+  return written;
+}
+
+static void *writer(void *arg) {
+  struct timespec interval = {0, LOG_INTERVAL_MS * 1000000L};
+  for (;;) {
+    pthread_mutex_lock(&DrainLock);
+    int written = drain();
+    pthread_mutex_unlock(&DrainLock);
+    if (written == 0) {
+      nanosleep(&interval, NULL);
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief Write out every message logged so far
+ * registered to run at exit, so a failing server still prints what it
+ * logged before
+ */
+void log_flush() {
+  if (!__atomic_load_n(&Started, __ATOMIC_ACQUIRE)) {
+    return;
+  }
+  pthread_mutex_lock(&DrainLock);
+  drain();
+  pthread_mutex_unlock(&DrainLock);
+}
+
+/**
+ * @brief Start the writer thread, messages are logged asynchronously from
+ * here on
+ * @param out_fd where LOG_INFO and LOG_DEBUG messages go
+ * @param err_fd where LOG_ERROR messages go
+ * @return int 0 on success, -1 if the writer could not be started
+ */
+int log_start(int out_fd, int err_fd) {
+  // anything printed through stdio so far goes out first
+  fflush(stdout);
+  fflush(stderr);
+  OutFd = Out.fd = out_fd;
+  ErrFd = Err.fd = err_fd;
+  if (pthread_create(&Writer, NULL, writer, NULL) != 0) {
+    return -1;
+  }
+  pthread_detach(Writer);
+  atexit(log_flush);
+  __atomic_store_n(&Started, 1, __ATOMIC_RELEASE);
+  return 0;
+}
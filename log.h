@@ -0,0 +1,54 @@
+/**
+  Asynchronous logging
+
+  Threads on the game path never write to stdout themselves: a message is
+  formatted into a fixed-size record in the calling thread's own ring
+  (one producer, one consumer) and a writer thread drains every ring in
+  the background, in the order the messages were logged. A slow terminal
+  or a full pipe only stalls the writer. A full ring drops the message
+  and counts it rather than block the game loop, and the writer reports
+  what was dropped. A thread's ring is allocated the first time it logs;
+  logging a message never allocates.
+
+  LogLevel selects what is logged and may be changed at any time.
+  Before log_start (and for threads beyond LOG_MAX_THREADS) messages are
+  written synchronously.
+*/
+
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+
+#define LOG_TEXT 240 // longer messages are truncated
+#define LOG_RING_SLOTS 1024 // per thread, a power of two
+#define LOG_MAX_THREADS 256
+#define LOG_INTERVAL_MS 5 // writer's sleep when every ring is empty
+
+enum Log_Level { LOG_ERROR, LOG_INFO, LOG_DEBUG };
+
+struct LogRecord {
+  int64_t time_ns; // orders records across rings
+  uint16_t level;
+  uint16_t length;
+  char text[LOG_TEXT];
+};
+
+struct LogRing {
+  struct LogRecord slots[LOG_RING_SLOTS];
+  // head is only advanced by the writer and tail by the owning thread,
+  // each on its own cache line
+  uint64_t head __attribute__((aligned(64)));
+  uint64_t tail __attribute__((aligned(64)));
+  uint64_t dropped;
+  uint64_t reported; // drops the writer has reported, writer only
+};
+
+extern int LogLevel; // atomic
+
+int log_start(int out_fd, int err_fd);
+void log_printf(int level, const char *format, ...)
+    __attribute__((format(printf, 2, 3)));
+void log_flush();
+
+#endif
@@ -0,0 +1,193 @@
+/**
+  Live server metrics
+*/
+
+#include "metrics.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "proto.h"
+
+static struct Metrics *Registered[METRICS_MAX_THREADS];
+static int NumRegistered; // atomic
+
+static char *TYPE_NAMES[METRIC_TYPES] = {
+    "NAME_QUERY",        "NAME_RETURN",      "GAME_START", "QUESTION_SEND",
+    "QUESTION_RESPONSE", "ANSWER_BROADCAST", "FECKOFF",    "LEADERBOARD",
+    "SESSION",           "RESUME"};
+
+void metrics_init(struct Metrics *metrics) {
+  memset(metrics, 0, sizeof(*metrics));
+}
+
+/**
+ * @brief Add a thread's metrics to every later scrape
+ * must stay valid for the life of the process
+ * @param metrics
+ */
+void metrics_register(struct Metrics *metrics) {
+  int slot = __atomic_load_n(&NumRegistered, __ATOMIC_RELAXED);
+  if (slot >= METRICS_MAX_THREADS) {
+    fprintf(stderr, "Too many metrics threads, not registering.\n");
+    return;
+  }
+  Registered[slot] = metrics;
+  __atomic_store_n(&NumRegistered, slot + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Monotonic clock in nanoseconds
+ */
+long long metrics_now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static uint64_t load(uint64_t *field) {
+  return __atomic_load_n(field, __ATOMIC_RELAXED);
+}
+
+static void write_histogram(FILE *out, char *name, char *help,
+                            struct Histogram *hist) {
+  fprintf(out, "# HELP %s %s\n", name, help);
+  fprintf(out, "# TYPE %s summary\n", name);
+  double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+  for (int i = 0; i < 4; i++) {
+    fprintf(out, "%s{quantile=\"%g\"} %.1f\n", name, quantiles[i],
+            hist_percentile(hist, quantiles[i] * 100) / 1e3);
+  }
+  fprintf(out, "%s_sum %.1f\n", name, hist->sum / 1e3);
+  fprintf(out, "%s_count %llu\n", name, (unsigned long long)hist->count);
+}
+
+/**
+ * @brief Sum every registered thread and write one scrape
+ * @param out
+ */
+static void write_metrics(FILE *out) {
+  struct Metrics total;
+  metrics_init(&total);
+  int count = __atomic_load_n(&NumRegistered, __ATOMIC_ACQUIRE);
+
+  for (int t = 0; t < count; t++) {
+    struct Metrics *metrics = Registered[t];
+    total.accepts += load(&metrics->accepts);
+    total.wakeups += load(&metrics->wakeups);
+    for (int i = 0; i < METRIC_TYPES; i++) {
+      total.messages_in[i] += load(&metrics->messages_in[i]);
+      total.messages_out[i] += load(&metrics->messages_out[i]);
+    }
+    total.bytes_in += load(&metrics->bytes_in);
+    total.bytes_out += load(&metrics->bytes_out);
+    total.sends += load(&metrics->sends);
+    hist_merge(&total.answer_latency, &metrics->answer_latency);
+    hist_merge(&total.fanout, &metrics->fanout);
+  }
+
+  fprintf(out, "# TYPE trivia_accepts_total counter\n");
+  fprintf(out, "trivia_accepts_total %llu\n",
+          (unsigned long long)total.accepts);
+  fprintf(out, "# TYPE trivia_wakeups_total counter\n");
+  fprintf(out, "trivia_wakeups_total %llu\n",
+          (unsigned long long)total.wakeups);
+
+  fprintf(out, "# TYPE trivia_messages_in_total counter\n");
+  for (int i = 0; i < METRIC_TYPES; i++) {
+    fprintf(out, "trivia_messages_in_total{type=\"%s\"} %llu\n",
+            TYPE_NAMES[i], (unsigned long long)total.messages_in[i]);
+  }
+  fprintf(out, "# TYPE trivia_messages_out_total counter\n");
+  for (int i = 0; i < METRIC_TYPES; i++) {
+    fprintf(out, "trivia_messages_out_total{type=\"%s\"} %llu\n",
+            TYPE_NAMES[i], (unsigned long long)total.messages_out[i]);
+  }
+
+  fprintf(out, "# TYPE trivia_bytes_in_total counter\n");
+  fprintf(out, "trivia_bytes_in_total %llu\n",
+          (unsigned long long)total.bytes_in);
+  fprintf(out, "# TYPE trivia_bytes_out_total counter\n");
+  fprintf(out, "trivia_bytes_out_total %llu\n",
+          (unsigned long long)total.bytes_out);
+  fprintf(out, "# TYPE trivia_sends_total counter\n");
+  fprintf(out, "trivia_sends_total %llu\n", (unsigned long long)total.sends);
+
+  write_histogram(out, "trivia_answer_latency_us",
+                  "Time from QUESTION_SEND to the first answer.",
+                  &total.answer_latency);
+  write_histogram(out, "trivia_broadcast_fanout_us",
+                  "Time to queue a broadcast for every player in a room.",
+                  &total.fanout);
+}
+
+/**
+ * @brief Metrics thread: one scrape per connection
+ */
+static void *metrics_handler(void *arg) {
+  int listen_fd = (int)(intptr_t)arg;
+
+  while (1) {
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0) {
+      continue;
+    }
+
+    char *text = NULL;
+    size_t length = 0;
+    FILE *out = open_memstream(&text, &length);
+    if (out != NULL) {
+      write_metrics(out);
+      fclose(out);
+      swrite(fd, text, length);
+      free(text);
+    }
+    close(fd);
+  }
+  return NULL;
+}
+
+/**
+ * @brief Serve metrics on a Unix domain socket from a background thread
+ * a stale socket file at path is replaced
+ * @param path
+ * @return int 0 on success, -1 on error
+ */
+int metrics_serve(const char *path) {
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "Metrics socket path too long.\n");
+    return -1;
+  }
+  strcpy(addr.sun_path, path);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    perror("socket");
+    return -1;
+  }
+  unlink(path);
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+      listen(fd, 16) < 0) {
+    perror("metrics socket");
+    close(fd);
+    return -1;
+  }
+
+  pthread_t thread;
+  if (pthread_create(&thread, NULL, metrics_handler, (void *)(intptr_t)fd) !=
+      0) {
+    close(fd);
+    return -1;
+  }
+  pthread_detach(thread);
+  return 0;
+}
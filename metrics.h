@@ -0,0 +1,50 @@
+/**
+  Live server metrics
+
+  Every thread records into its own struct Metrics, so the hot path is a
+  plain store with no locks or atomic read-modify-writes. A metrics thread
+  serves the sum of all registered threads on a Unix domain socket: each
+  connection gets one snapshot in Prometheus text format and is closed
+  (e.g. `nc -U trivia.sock`).
+
+  Readers may catch a histogram mid-update; a scrape is a snapshot, not a
+  transaction.
+*/
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+
+#include "hist.h"
+
+// message types are the Event_Dict values
+#define METRIC_TYPES 10
+#define METRICS_MAX_THREADS 256
+
+struct Metrics {
+  uint64_t accepts;
+  uint64_t wakeups;
+  uint64_t messages_in[METRIC_TYPES];
+  uint64_t messages_out[METRIC_TYPES];
+  uint64_t bytes_in;
+  uint64_t bytes_out;
+  uint64_t sends; // gathered writes handed to the kernel
+  struct Histogram answer_latency; // QUESTION_SEND to first answer, ns
+  struct Histogram fanout;         // queueing a broadcast, ns
+};
+
+/**
+  Add to a counter owned by the calling thread.
+  Single writer, so a relaxed store is enough for readers to see whole
+  values.
+ */
+#define METRIC_ADD(field, n)                                                  \
+  __atomic_store_n(&(field), (field) + (n), __ATOMIC_RELAXED)
+
+void metrics_init(struct Metrics *metrics);
+void metrics_register(struct Metrics *metrics);
+long long metrics_now();
+int metrics_serve(const char *path);
+
+#endif
@@ -0,0 +1,528 @@
+/**
+  Wire protocol shared by the trivia server and client
+*/
+
+#include "proto.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/**
+ * @brief Allocate a ring buffer
+ * size must be a power of two
+ * @param ring
+ * @param size
+ * @return int 0 on success, -1 on failure
+ */
+int ring_init(struct RingBuf *ring, size_t size) {
+  if (size == 0 || (size & (size - 1)) != 0) {
+    return -1;
+  }
+  ring->data = malloc(size);
+  if (ring->data == NULL) {
+    return -1;
+  }
+  ring->size = size;
+  ring->head = 0;
+  ring->tail = 0;
+  return 0;
+}
+
+void ring_free(struct RingBuf *ring) {
+  free(ring->data);
+  ring->data = NULL;
+  ring->size = 0;
+  ring->head = 0;
+  ring->tail = 0;
+}
+
+size_t ring_used(struct RingBuf *ring) { return ring->tail - ring->head; }
+
+/**
+ * @brief Read from fd into the free space of the ring
+ * a single recvmsg covers both free segments when the space wraps
+ * @param ring
+ * @param fd
+ * @param flags recv flags (MSG_DONTWAIT for edge-triggered readers)
+ * @return ssize_t recv result: bytes read, 0 on EOF, -1 on error (errno set).
+ * A full ring returns -1 with errno ENOBUFS.
+ */
+ssize_t ring_fill(struct RingBuf *ring, int fd, int flags) {
+  size_t mask = ring->size - 1;
+  size_t free_space = ring->size - ring_used(ring);
+  if (free_space == 0) {
+    errno = ENOBUFS;
+    return -1;
+  }
+
+  // reset positions on an empty ring so reads start contiguous
+  if (ring->head == ring->tail) {
+    ring->head = 0;
+    ring->tail = 0;
+  }
+
+  size_t start = ring->tail & mask;
+  struct iovec iov[2];
+  int iovcnt = 1;
+  iov[0].iov_base = ring->data + start;
+  if (start + free_space <= ring->size) {
+    iov[0].iov_len = free_space;
+  } else {
+    iov[0].iov_len = ring->size - start;
+    iov[1].iov_base = ring->data;
+    iov[1].iov_len = free_space - iov[0].iov_len;
+    iovcnt = 2;
+  }
+
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = iovcnt;
+
+  ssize_t amount = recvmsg(fd, &msg, flags);
+  if (amount > 0) {
+    ring->tail += amount;
+  }
+  return amount;
+}
+
+/**
+ * @brief Copy bytes already received elsewhere into the free space of the
+ * ring (for completion based readers that do not read the socket directly)
+ * @param ring
+ * @param data
+ * @param len
+ * @return size_t bytes copied, less than len when the ring fills up
+ */
+size_t ring_put(struct RingBuf *ring, const char *data, size_t len) {
+  size_t free_space = ring->size - ring_used(ring);
+  if (len > free_space) {
+    len = free_space;
+  }
+  if (ring->head == ring->tail) {
+    ring->head = 0;
+    ring->tail = 0;
+  }
+
+  size_t start = ring->tail & (ring->size - 1);
+  size_t first = ring->size - start;
+  if (first >= len) {
+    memcpy(ring->data + start, data, len);
+  } else {
+    memcpy(ring->data + start, data, first);
+    memcpy(ring->data, data + first, len - first);
+  }
+  ring->tail += len;
+  return len;
+}
+
+/**
+ * @brief Copy len bytes starting at ring position pos into dest
+ */
+static void ring_copy(struct RingBuf *ring, size_t pos, char *dest,
+                      size_t len) {
+  size_t mask = ring->size - 1;
+  size_t start = pos & mask;
+  size_t first = ring->size - start;
+  if (first >= len) {
+    memcpy(dest, ring->data + start, len);
+  } else {
+    memcpy(dest, ring->data + start, first);
+    memcpy(dest + first, ring->data, len - first);
+  }
+}
+
+/**
+ * @brief Extract the next complete frame from the ring
+ * payload points into the ring when contiguous, otherwise the frame is
+ * copied into scratch (which must hold ring->size bytes). The view stays
+ * valid until the next ring_fill. The payload is not NUL terminated.
+ * @param ring
+ * @param scratch
+ * @param payload
+ * @param length
+ * @return int 1 if a frame was extracted, 0 if more bytes are needed,
+ * -1 if the frame can never fit in this ring
+ */
+int ring_next_frame(struct RingBuf *ring, char *scratch, char **payload,
+                    size_t *length) {
+  size_t used = ring_used(ring);
+  if (used < FRAME_HEADER) {
+    return 0;
+  }
+
+  unsigned char header[FRAME_HEADER];
+  ring_copy(ring, ring->head, (char *)header, FRAME_HEADER);
+  size_t frame_len = ((size_t)header[0] << 8) | header[1];
+  if (frame_len > ring->size - FRAME_HEADER) {
+    return -1;
+  }
+  if (used < FRAME_HEADER + frame_len) {
+    return 0;
+  }
+
+  size_t mask = ring->size - 1;
+  size_t start = (ring->head + FRAME_HEADER) & mask;
+  if (start + frame_len <= ring->size) {
+    *payload = ring->data + start;
+  } else {
+    ring_copy(ring, ring->head + FRAME_HEADER, scratch, frame_len);
+    *payload = scratch;
+  }
+  *length = frame_len;
+  ring->head += FRAME_HEADER + frame_len;
+  return 1;
+}
+
+/**
+ * @brief Check whether a complete frame is buffered without consuming it
+ * @param ring
+ * @return int 1 if ring_next_frame would return a frame (or an error)
+ */
+int ring_has_frame(struct RingBuf *ring) {
+  size_t used = ring_used(ring);
+  if (used < FRAME_HEADER) {
+    return 0;
+  }
+
+  unsigned char header[FRAME_HEADER];
+  ring_copy(ring, ring->head, (char *)header, FRAME_HEADER);
+  size_t frame_len = ((size_t)header[0] << 8) | header[1];
+  return frame_len > ring->size - FRAME_HEADER ||
+         used >= FRAME_HEADER + frame_len;
+}
+
+/**
+ * @brief Split a payload into field views in place
+ * nothing is copied or allocated; each field points into payload
+ * @param payload
+ * @param length
+ * @param delim
+ * @param fields
+ * @param max_fields
+ * @return int number of fields, -1 if there are more than max_fields
+ */
+int tokenize(char *payload, size_t length, char delim, struct Field *fields,
+             int max_fields) {
+  int count = 0;
+  char *cursor = payload;
+  char *end = payload + length;
+
+  while (1) {
+    if (count == max_fields) {
+      return -1;
+    }
+    char *found = memchr(cursor, delim, end - cursor);
+    fields[count].ptr = cursor;
+    if (found == NULL) {
+      fields[count].len = end - cursor;
+      return count + 1;
+    }
+    fields[count].len = found - cursor;
+    count++;
+    cursor = found + 1;
+  }
+}
+
+/**
+ * @brief Number of fields (including the type) a message type carries
+ * @param type
+ * @return int field count, -1 for unknown types
+ */
+int expected_fields(int type) {
+  switch (type) {
+  case NAME_QUERY:
+  case GAME_START:
+  case FECKOFF:
+    return 1;
+  case NAME_RETURN:
+  case QUESTION_RESPONSE:
+  case ANSWER_BROADCAST:
+  case RESUME:
+    return 2;
+  case LEADERBOARD:
+    return 4;
+  case SESSION:
+    return 5;
+  case QUESTION_SEND:
+    return 6;
+  }
+  return -1;
+}
+
+/**
+ * @brief atoi over a field view
+ * parses an optional sign and leading digits, stopping at the first
+ * non-digit like atoi does. Fields come from peers, so values past INT_MAX
+ * saturate instead of overflowing.
+ * @param field
+ * @return int
+ */
+int field_int(struct Field field) {
+  size_t i = 0;
+  int sign = 1;
+  int value = 0;
+
+  if (i < field.len && (field.ptr[i] == '-' || field.ptr[i] == '+')) {
+    sign = field.ptr[i] == '-' ? -1 : 1;
+    i++;
+  }
+  for (; i < field.len && field.ptr[i] >= '0' && field.ptr[i] <= '9'; i++) {
+    int digit = field.ptr[i] - '0';
+    if (value > (INT_MAX - digit) / 10) {
+      value = INT_MAX;
+    } else {
+      value = value * 10 + digit;
+    }
+  }
+  return sign * value;
+}
+
+// longest message type field accepted, types are small numbers
+#define TYPE_DIGITS 3
+
+/**
+ * @brief Tokenize a message and validate its field count against its type
+ * @param payload
+ * @param length
+ * @param fields
+ * @return int message type (Event_Dict), -1 if malformed
+ */
+int parse_message(char *payload, size_t length,
+                  struct Field fields[MAX_FIELDS]) {
+  int count = tokenize(payload, length, FIELD_DELIM, fields, MAX_FIELDS);
+  if (count < 1 || fields[0].len == 0 || fields[0].len > TYPE_DIGITS) {
+    return -1;
+  }
+  int type = field_int(fields[0]);
+  if (expected_fields(type) != count) {
+    return -1;
+  }
+  return type;
+}
+
+/**
+ * @brief printf a payload into dest and prefix it with the frame header
+ * payloads that do not fit are truncated, as snprintf would
+ * @param dest
+ * @param size
+ * @param format
+ * @param ...
+ * @return int total frame length (header + payload)
+ */
+int frame_printf(char *dest, size_t size, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(dest + FRAME_HEADER, size - FRAME_HEADER, format, args);
+  va_end(args);
+
+  size_t max_payload = size - FRAME_HEADER - 1;
+  if (max_payload > FRAME_MAX) {
+    max_payload = FRAME_MAX;
+  }
+  size_t length = n < 0 ? 0 : (size_t)n;
+  if (length > max_payload) {
+    length = max_payload;
+  }
+
+  dest[0] = (length >> 8) & 0xff;
+  dest[1] = length & 0xff;
+  return FRAME_HEADER + length;
+}
+
+/**
+  "Safe write"
+  continues writing until all bytes written
+ */
+ssize_t swrite(int fd, char *message, size_t length) {
+  if (fd == -1) {
+    return -1;
+  }
+  size_t written = 0;
+  while (written < length) {
+    ssize_t n = write(fd, message + written, length - written);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("write");
+      return -1;
+    }
+    written += n;
+  }
+
+  return written;
+}
+
+/**
+ * @brief Encode a frame once into a reference counted buffer
+ * the caller owns the returned reference
+ * @param format
+ * @param ...
+ * @return struct OutBuf* NULL on allocation failure
+ */
+struct OutBuf *outbuf_printf(const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  va_list sizing;
+  va_copy(sizing, args);
+  int n = vsnprintf(NULL, 0, format, sizing);
+  va_end(sizing);
+
+  size_t length = n < 0 ? 0 : (size_t)n;
+  if (length > FRAME_MAX) {
+    length = FRAME_MAX;
+  }
+
+  struct OutBuf *buf =
+      malloc(sizeof(struct OutBuf) + FRAME_HEADER + length + 1);
+  if (buf == NULL) {
+    va_end(args);
+    return NULL;
+  }
+  vsnprintf(buf->data + FRAME_HEADER, length + 1, format, args);
+  va_end(args);
+
+  buf->data[0] = (length >> 8) & 0xff;
+  buf->data[1] = length & 0xff;
+  buf->length = FRAME_HEADER + length;
+  buf->refs = 1;
+  return buf;
+}
+
+struct OutBuf *outbuf_ref(struct OutBuf *buf) {
+  if (buf->refs != OUTBUF_PINNED) {
+    __atomic_fetch_add(&buf->refs, 1, __ATOMIC_RELAXED);
+  }
+  return buf;
+}
+
+void outbuf_release(struct OutBuf *buf) {
+  if (buf == NULL || buf->refs == OUTBUF_PINNED) {
+    return;
+  }
+  if (__atomic_sub_fetch(&buf->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+    free(buf);
+  }
+}
+
+void outq_init(struct OutQueue *queue) { memset(queue, 0, sizeof(*queue)); }
+
+/**
+ * @brief Release every queued frame and free the queue storage
+ */
+void outq_clear(struct OutQueue *queue) {
+  for (size_t i = 0; i < queue->count; i++) {
+    outbuf_release(queue->bufs[(queue->head + i) % queue->capacity]);
+  }
+  free(queue->bufs);
+  outq_init(queue);
+}
+
+/**
+ * @brief Append a frame to the queue, taking a new reference to it
+ * @param queue
+ * @param buf
+ * @return int 0 on success, -1 on allocation failure
+ */
+int outq_push(struct OutQueue *queue, struct OutBuf *buf) {
+  if (queue->count == queue->capacity) {
+    size_t capacity = queue->capacity ? queue->capacity * 2 : 4;
+    struct OutBuf **bufs = malloc(sizeof(struct OutBuf *) * capacity);
+    if (bufs == NULL) {
+      return -1;
+    }
+    for (size_t i = 0; i < queue->count; i++) {
+      bufs[i] = queue->bufs[(queue->head + i) % queue->capacity];
+    }
+    free(queue->bufs);
+    queue->bufs = bufs;
+    queue->capacity = capacity;
+    queue->head = 0;
+  }
+
+  queue->bufs[(queue->head + queue->count) % queue->capacity] = outbuf_ref(buf);
+  queue->count++;
+  queue->queued_bytes += buf->length;
+  return 0;
+}
+
+/**
+ * @brief Point iovecs at the unwritten part of the queue
+ * @param queue
+ * @param iov
+ * @param max_iov
+ * @return int iovecs filled, 0 for an empty queue
+ */
+int outq_iov(struct OutQueue *queue, struct iovec *iov, int max_iov) {
+  int iovcnt = 0;
+  for (size_t i = 0; i < queue->count && iovcnt < max_iov; i++) {
+    struct OutBuf *buf = queue->bufs[(queue->head + i) % queue->capacity];
+    size_t skip = i == 0 ? queue->offset : 0;
+    iov[iovcnt].iov_base = buf->data + skip;
+    iov[iovcnt].iov_len = buf->length - skip;
+    iovcnt++;
+  }
+  return iovcnt;
+}
+
+/**
+ * @brief Drop `n` written bytes from the front of the queue
+ * fully written frames are released
+ * @param queue
+ * @param n
+ */
+void outq_consume(struct OutQueue *queue, size_t n) {
+  queue->queued_bytes -= n;
+  while (n > 0) {
+    struct OutBuf *buf = queue->bufs[queue->head];
+    size_t left = buf->length - queue->offset;
+    if (n < left) {
+      queue->offset += n;
+      break;
+    }
+    n -= left;
+    outbuf_release(buf);
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->count--;
+    queue->offset = 0;
+  }
+}
+
+/**
+ * @brief Write as much of the queue as the socket accepts
+ * every queued frame goes out in one gathered sendmsg per call, never
+ * blocking; fully written frames are released
+ * @param queue
+ * @param fd non-blocking socket
+ * @return ssize_t bytes still queued, -1 on a socket error
+ */
+ssize_t outq_flush(struct OutQueue *queue, int fd) {
+  while (queue->count > 0) {
+    struct iovec iov[OUTQ_IOV];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = outq_iov(queue, iov, OUTQ_IOV);
+    ssize_t n = sendmsg(fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        break;
+      }
+      return -1;
+    }
+    outq_consume(queue, n);
+  }
+
+  return queue->queued_bytes;
+}
@@ -0,0 +1,119 @@
+/**
+  Wire protocol shared by the trivia server and client
+
+  Every message is a frame: a 2 byte big-endian payload length followed by
+  the payload. Payloads are the usual "type|arg|arg" text, so a frame never
+  depends on a terminator byte and split or merged TCP segments are
+  reassembled by the receiver's ring buffer.
+*/
+
+#ifndef PROTO_H
+#define PROTO_H
+
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#define FRAME_HEADER 2
+#define FRAME_MAX 65535
+// smallest power of two ring that holds any frame
+#define FRAME_RING (128 * 1024)
+#define FIELD_DELIM '|'
+#define MAX_FIELDS 8
+// frames gathered into one send
+#define OUTQ_IOV 64
+
+enum Event_Dict {
+  NAME_QUERY,
+  NAME_RETURN,
+  GAME_START,
+  QUESTION_SEND,
+  QUESTION_RESPONSE,
+  ANSWER_BROADCAST,
+  FECKOFF,
+  LEADERBOARD,
+  SESSION, // token|questions_done|score|rank, empty token if resume failed
+  RESUME   // token, first message on a reconnect
+};
+
+/**
+  Per-connection receive buffer.
+  `head` and `tail` only ever grow; the capacity is a power of two so
+  positions are mapped into `data` with a mask.
+ */
+struct RingBuf {
+  char *data;
+  size_t size;
+  size_t head; // next byte to consume
+  size_t tail; // next byte to fill
+};
+
+/**
+  View of one field inside a frame payload.
+  Points into the receive buffer and is not NUL terminated.
+ */
+struct Field {
+  char *ptr;
+  size_t len;
+};
+
+/**
+  Encoded frame shared by every connection it is queued on.
+  Built once per broadcast and freed when the last queue releases it.
+  Frames with refs == OUTBUF_PINNED belong to something longer lived (a
+  question bank) and are never counted or freed.
+ */
+#define OUTBUF_PINNED -1
+
+struct OutBuf {
+  int refs; // atomic
+  size_t length;
+  char data[];
+};
+
+/**
+  Per-connection output queue of frame references.
+  `offset` is how much of the head frame has already been written.
+ */
+struct OutQueue {
+  struct OutBuf **bufs;
+  size_t capacity;
+  size_t head;
+  size_t count;
+  size_t offset;
+  size_t queued_bytes;
+};
+
+int ring_init(struct RingBuf *ring, size_t size);
+void ring_free(struct RingBuf *ring);
+size_t ring_used(struct RingBuf *ring);
+ssize_t ring_fill(struct RingBuf *ring, int fd, int flags);
+size_t ring_put(struct RingBuf *ring, const char *data, size_t len);
+int ring_next_frame(struct RingBuf *ring, char *scratch, char **payload,
+                    size_t *length);
+int ring_has_frame(struct RingBuf *ring);
+
+int tokenize(char *payload, size_t length, char delim, struct Field *fields,
+             int max_fields);
+int expected_fields(int type);
+int field_int(struct Field field);
+int parse_message(char *payload, size_t length,
+                  struct Field fields[MAX_FIELDS]);
+
+int frame_printf(char *dest, size_t size, const char *format, ...)
+    __attribute__((format(printf, 3, 4)));
+ssize_t swrite(int fd, char *message, size_t length);
+
+struct OutBuf *outbuf_printf(const char *format, ...)
+    __attribute__((format(printf, 1, 2)));
+struct OutBuf *outbuf_ref(struct OutBuf *buf);
+void outbuf_release(struct OutBuf *buf);
+
+void outq_init(struct OutQueue *queue);
+void outq_clear(struct OutQueue *queue);
+int outq_push(struct OutQueue *queue, struct OutBuf *buf);
+int outq_iov(struct OutQueue *queue, struct iovec *iov, int max_iov);
+void outq_consume(struct OutQueue *queue, size_t n);
+ssize_t outq_flush(struct OutQueue *queue, int fd);
+
+#endif
@@ -1,3 +1,3 @@
 [ -d Build ] || mkdir Build &&
-gcc -g client.c -o Build/client &&
+gcc -g client.c proto.c -o Build/client &&
 ./Build/client "$@"
@@ -1,3 +1,5 @@
 [ -d Build ] || mkdir Build &&
-gcc -g server.c -o Build/server &&
+gcc -g -pthread server.c proto.c bank.c arena.c hist.c metrics.c timer.c \
+    leaderboard.c uring.c session.c journal.c shuffle.c log.c \
+    -o Build/server &&
 ./Build/server "$@"
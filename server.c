@@ -3,35 +3,106 @@
   I pledge my honor that I have abided by the Stevens Honor System.
 */
 
+#define _GNU_SOURCE
 #include <arpa/inet.h>
+#include <errno.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/select.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/random.h>
+#include <sys/resource.h>
 #include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <time.h>
 #include <unistd.h>
 
+#include "arena.h"
+#include "bank.h"
+#include "journal.h"
+#include "leaderboard.h"
+#include "log.h"
+#include "metrics.h"
+#include "proto.h"
+#include "session.h"
+#include "shuffle.h"
+#include "timer.h"
+#include "uring.h"
+
 /**
  * DEFINE CONSTANTS
  */
-const int MAX_CLIENTS = 3;
-char *QUESTION_DELIM = " ";
-char *VALID_ARGS[] = {"-f", "-i", "-p", "-h", NULL};
+char *VALID_ARGS[] = {"-f", "-i", "-p", "-t", "-w", "-c", "-m",
+                      "-d", "-b", "-u", "-n", "-x", "-l", "-j", "-g",
+                      "-q", "-s", "-v", "-h", NULL};
 int STRLEN = 1024;
-int DEBUG = 0;
 char *DEFAULT_QUESTION_FILE = "qshort.txt";
 char *DEFAULT_IP = "127.0.0.1";
-char *SOCK_DELIM = "|";
-char SOCK_END = '\\';
+const int MAX_EVENTS = 1024;
+#define INBOX_SIZE 2048
+#define NAME_MAX_LEN 127 // longer player names are cut
+// queued output past which a client is considered a slow consumer
+size_t HIGH_WATER = 256 * 1024;
+// answer window per question, 0 waits for every live player
+long long ANSWER_WINDOW_MS = 20000;
+// room sizes: a lobby starts as soon as it holds ROOM_MAX players, or
+// LOBBY_WAIT_MS after it reached ROOM_MIN
+int ROOM_MIN = 2;
+int ROOM_MAX = 3;
+long long LOBBY_WAIT_MS = 10000;
+// a full lobby starts this long after it closed: the connection that
+// filled it may be a player coming back whose RESUME is still in flight
+#define RESUME_GRACE_MS 200
+// questions per game drawn from the bank, 0 asks all of them
+int GAME_QUESTIONS = 0;
+// every room's question order derives from this seed and the room id (-s)
+uint64_t ORDER_SEED;
+// timer wheel resolution
+#define TICK_MS 10
+// leaderboard slots pushed to players after every question
+#define LEADERBOARD_K 10
+// pending connections each worker's listener queues
+int BACKLOG = 4096;
+// connections a worker accepts per wakeup before serving its rooms again
+#define ACCEPT_BATCH 64
+// run workers on io_uring instead of epoll (-u)
+int USE_URING = 0;
+#define URING_ENTRIES 4096
+// provided receive buffers per worker; client messages are small
+#define URING_BUFS 1024
+#define URING_BUF_SIZE 512
+// frames gathered into one io_uring send
+#define URING_SEND_IOV 16
+// longest a score event waits for its journal group commit (-g)
+long long JOURNAL_INTERVAL_MS = 10;
+// bytes of events buffered per journal group
+#define JOURNAL_BUFFER (1 << 20)
 
-// define structs
-struct Entry {
-  char prompt[1024];
-  char options[3][50];
-  int answer_idx;
+/**
+  io_uring completions carry (generation, fd, op) instead of a pointer:
+  a completion can arrive after its player was dropped and its room freed,
+  and the generation tells it apart from a new connection that reused the
+  fd number.
+ */
+enum Uring_Op {
+  URING_ACCEPT,
+  URING_RECV,
+  URING_SEND,
+  URING_TICK,
+  URING_MAIL,
+  URING_CANCEL
 };
+#define URING_DATA(gen, fd, op)                                                \
+  (((uint64_t)(gen) << 32) | ((uint64_t)(fd) << 8) | (op))
 
+// define structs
 struct GameState {
   int started;
   int clients_engaged;
@@ -39,27 +110,129 @@ struct GameState {
   int question_number;
   int question_total;
   int question_pending;
-  struct Entry active_question;
-  struct Entry *question_set;
+  int active_question; // bank index of the question being asked
+  struct Shuffle order; // bank indexes in asking order
+  long long question_sent_at;
+  int answers; // connected players that answered the active question
+  struct QuestionBank *bank;
+};
+
+/**
+  Gathered send of an io_uring player, kept until the kernel is done with
+  it. Allocated on the player's first send, epoll players have none. A
+  send still in flight when its connection goes away is handed to the
+  worker together with the frames it points at, and freed on completion.
+ */
+struct UringSend {
+  struct msghdr msg;
+  struct iovec iov[URING_SEND_IOV];
+  // set once orphaned
+  struct OutQueue frames;
+  uint32_t gen;
+  int fd;
+  struct UringSend *next;
 };
 
+/**
+  A seat's connection. Per-question state lives in the room's dense
+  per-seat arrays (scores on the leaderboard, answered) so the passes over
+  a room do not stride across these records.
+ */
 struct Player {
   int fd;
-  int score;
-  char name[128];
+  char *name; // in the room's name pool, "" until registered
+  struct RingBuf inbox;
+  struct OutQueue outbox;
+  int want_write;
+  uint64_t token; // session token, 0 until the player registered
+  struct Room *room;
+  int send_queued; // on the worker's send list
+  struct Player *send_next;
+  // io_uring backend
+  uint32_t gen;
+  int sending; // a send is in flight
+  struct UringSend *send;
+};
+
+/**
+  One independent game: its own state, question cursor and roster.
+  A room is owned by exactly one worker thread for its whole life.
+ */
+struct Room {
+  int id;
+  struct GameState state;
+  struct Player *players; // ROOM_MAX seats, empty ones have fd -1
+  int max_players;
+  int seated; // connected players
+  uint8_t *answered; // per seat: answered the active question
+  struct Arena names; // player names, freed with the room
+  struct Timer lobby_timer; // starts a lobby that reached ROOM_MIN
+  struct Timer deadline;    // ends the active question
+  struct Leaderboard board;
+  // top of the board as last pushed to players
+  int top[LEADERBOARD_K];
+  int top_score[LEADERBOARD_K];
+  int top_count;
+  struct Worker *worker;
+  struct Room *next;
+};
+
+/**
+  Work another thread hands to a worker: a reconnected socket on its way
+  to the worker that owns its player, or (bank set) a reloaded question
+  bank for the worker's new rooms
+ */
+struct Handoff {
+  uint64_t token; // 0 for a new connection
+  int fd;
+  struct QuestionBank *bank;
+  struct Handoff *next;
 };
 
-enum Event_Dict {
-  NAME_QUERY,
-  NAME_RETURN,
-  GAME_START,
-  QUESTION_SEND,
-  QUESTION_RESPONSE,
-  ANSWER_BROADCAST,
-  FECKOFF
+/**
+  Event loop thread that runs a shard of the rooms.
+  Every worker has its own SO_REUSEPORT listener, so the kernel spreads
+  incoming connections across workers and each one fills its own rooms
+  without touching another thread.
+ */
+struct Worker {
+  int id;
+  pthread_t thread;
+  int epoll_fd;
+  int listen_fd;
+  struct QuestionBank *bank; // for new rooms, only this worker swaps it
+  struct Room *lobby; // room being filled by new connections
+  struct Room *rooms;
+  int num_rooms;
+  int timer_fd; // ticks the wheel while any timer is armed
+  int ticking;
+  struct TimerWheel wheel;
+  struct Metrics metrics;
+  // io_uring backend, ring.fd is -1 on epoll workers
+  struct Uring ring;
+  struct UringBufRing bufs;
+  struct Player **conns; // live players by fd
+  int max_conns;
+  uint32_t next_gen;
+  struct Player *sends; // players with output queued in this wakeup
+  struct UringSend *orphans; // in flight for connections already gone
+  // connections accepted by other workers and reloaded banks, signalled
+  // through mail_fd
+  pthread_mutex_t mail_lock;
+  struct Handoff *mail;
+  int mail_fd;
 };
-// define game state
-struct GameState Game_State;
+
+// room ids are unique across workers
+int RoomCount; // atomic
+struct Worker *Workers;
+int NumWorkers;
+// worker whose lobby takes new players, whichever worker accepted them;
+// lobbies split across workers might each wait short of ROOM_MIN forever
+int LobbyWorker; // atomic
+struct SessionTable Sessions;
+struct Journal *ScoreJournal; // NULL unless -j
+
 
 /**
  * @brief Print message to stderr and exit with error code 1
@@ -77,12 +250,44 @@ void failwith(char *message) {
  * @param execname
  */
 void print_help(char *execname) {
-  printf("Usage: %s [-f question_file] [-i IP_address] [-p port_number] [-h]\n",
+  printf("Usage: %s [-f question_file] [-i IP_address] [-p port_number] "
+         "[-t threads] [-w bytes] [-c bank_file] [-m metrics_socket] "
+         "[-d seconds] [-b backlog] [-u] [-n min_players] [-x max_players] "
+         "[-l seconds] [-j journal_file] [-g seconds] [-q questions] [-s seed] "
+         "[-v level] [-h]\n",
          execname);
   printf("\n");
   printf("  -f question_file    Default to \"qshort.txt\";\n");
+  printf("                      (reloaded on SIGHUP, running games keep "
+         "theirs)\n");
   printf("  -i IP_address       Default to \"127.0.0.1\";\n");
   printf("  -p port_number      Default to 25555;\n");
+  printf("  -t threads          Default to number of cores;\n");
+  printf("  -w bytes            Default to 262144 (slow client cutoff);\n");
+  printf("  -c bank_file        Compile questions to bank_file and exit;\n");
+  printf("  -m metrics_socket   Serve live metrics on this Unix socket;\n");
+  printf("  -d seconds          Answer window per question, default to 20;\n");
+  printf("                      (0 waits for every player to answer)\n");
+  printf("  -b backlog          Pending connections per thread, default to "
+         "4096;\n");
+  printf("  -u                  Use io_uring instead of epoll when the "
+         "kernel allows it;\n");
+  printf("  -n min_players      Players a lobby needs to start, default to "
+         "2;\n");
+  printf("  -x max_players      Players per room, default to 3;\n");
+  printf("  -l seconds          Lobby wait once min_players joined, default "
+         "to 10;\n");
+  printf("  -j journal_file     Append every score event to journal_file;\n");
+  printf("  -g seconds          Journal group commit interval, default to "
+         "0.01;\n");
+  printf("                      (0 syncs as soon as the last sync is done)\n");
+  printf("  -q questions        Questions per game, default to the whole "
+         "bank;\n");
+  printf("  -s seed             Seed for every room's question order, default "
+         "to random;\n");
+  printf("  -v level            Log level: 0 errors, 1 game events, 2 debug, "
+         "default to 1;\n");
+  printf("                      (SIGUSR1 raises it and SIGUSR2 lowers it)\n");
   printf("  -h                  Display this help info.\n");
 }
 
@@ -104,312 +309,561 @@ int valid_argument(char *arg) {
   return 0;
 }
 
+void print_question(const char *prompt, const char *options[3],
+                    int question_number) {
+  log_printf(LOG_INFO,
+             "Question %d: %s\nPress 1: %s\nPress 2: %s\nPress 3: %s\n",
+             question_number, prompt, options[0], options[1], options[2]);
+}
+
 /**
- * @brief Split string into string[] by delimiter
- *
- * @param str
- * @param delim
- * @return int
+ * @brief Current timer wheel tick
  */
-int split_option(char dest[3][50], char *str, char *delim) {
-  // char *src_str = strdup(str); // malloc()
-  char *found;
-
-  int result_pos = 0;
+uint64_t current_tick() { return metrics_now() / (TICK_MS * 1000000LL); }
 
-  // string spot
-  while ((found = strsep(&str, delim)) != NULL) {
-    if (result_pos < 3) {
-      strcpy(dest[result_pos], found);
-      result_pos++;
-    }
+/**
+ * @brief Run the worker's tick timer only while timers are armed
+ * @param worker
+ */
+void update_ticking(struct Worker *worker) {
+  int ticking = worker->wheel.count > 0;
+  if (worker->ticking == ticking) {
+    return;
   }
 
-  free(found);
-  return result_pos + 1;
+  struct itimerspec spec;
+  memset(&spec, 0, sizeof(spec));
+  if (ticking) {
+    spec.it_value.tv_nsec = TICK_MS * 1000000L;
+    spec.it_interval.tv_nsec = TICK_MS * 1000000L;
+  }
+  if (timerfd_settime(worker->timer_fd, 0, &spec, NULL) < 0) {
+    log_printf(LOG_ERROR, "timerfd_settime: %m\n");
+    return;
+  }
+  worker->ticking = ticking;
 }
 
 /**
- * @brief Split string by delim into string[]
- *
- * @param dest
- * @param str
- * @param delim
- * @return int
+ * @brief Arm one of a worker's timers `delay_ms` from now
+ * @param worker
+ * @param timer
+ * @param delay_ms
  */
-int split_by_delim(char dest[128][1024], char *str, char *delim) {
-  char *src_str = strdup(str); // malloc()
-  char *src_str_saveptr = src_str;
-  char *found;
-
-  int result_pos = 0;
-
-  // string spot
-  while ((found = strsep(&src_str, delim)) != NULL) {
-    strcpy(dest[result_pos], found);
-    result_pos++;
+void arm_timer(struct Worker *worker, struct Timer *timer, long long delay_ms) {
+  if (worker->wheel.count == 0) {
+    // an idle wheel skips straight to the present
+    worker->wheel.now = current_tick();
   }
-
-  free(found);
-  free(src_str_saveptr);
-  return result_pos + 1;
+  timer_schedule(&worker->wheel, timer, current_tick() + delay_ms / TICK_MS);
+  update_ticking(worker);
 }
 
-void parse_error(char *filepath, int line_num, char *reason) {
-  fprintf(stderr, "Parsing error: %s(%d) ~ %s\n", filepath, line_num, reason);
-  exit(1);
+/**
+ * @brief Arm a room's question deadline `delay_ms` from now
+ * @param room
+ * @param delay_ms
+ */
+void arm_deadline(struct Room *room, long long delay_ms) {
+  arm_timer(room->worker, &room->deadline, delay_ms);
 }
 
 /**
- * @brief read questions from question file
- * Will not be more than 50 questions, but check for that anyway
-    destroy with destroy_entries
-    derived from: https://stackoverflow.com/a/3501681/13307600
- * @param arr
- * @param filename
- * @return int number of questions read
+ * @brief returns 1 if every connected player answered the active question
+ * @param room
+ * @return int
  */
-int read_questions(struct Entry *arr, char *filename) {
-  FILE *fp;
-  char *line = NULL;
-  size_t len = 0;
-  ssize_t read;
-
-  // keep track of position in entry array
-  int entry_num = 0;
-  int line_num = 1;
-
-  // declare template struct
-  struct Entry *this_entry = &arr[entry_num];
-
-  /**
-   * change behavior based on line number
-   * 0 -> line separator
-   * 1 -> prompt (string)
-   * 2 -> questions (split_option)
-   * 3 -> answer (get index)
-   * reset to 0 once question ended
-   */
-  int line_type = 1;
+int all_answered(struct Room *room) {
+  return room->state.answers >= room->seated;
+}
 
-  // open question file
-  if ((fp = fopen(filename, "r")) == NULL) {
-    fprintf(stderr, "Failed to read question file: %s\n", filename);
-    exit(1);
+/**
+ * @brief Hand a client's send in flight over to its worker
+ * the kernel reads the send's iovecs until its completion arrives, so the
+ * UringSend and the queued frames outlive the connection and are released
+ * by uring_sent. The client is left with an empty queue and no send.
+ * @param worker
+ * @param client
+ */
+void uring_orphan_send(struct Worker *worker, struct Player *client) {
+  if (!client->sending) {
+    return;
   }
+  struct UringSend *send = client->send;
+  send->frames = client->outbox;
+  outq_init(&client->outbox);
+  send->gen = client->gen;
+  send->fd = client->fd;
+  send->next = worker->orphans;
+  worker->orphans = send;
+  client->send = NULL;
+  client->sending = 0;
+}
 
-  // read by line
-  while ((read = getline(&line, &len, fp)) != -1) {
-    // remove '\n' from line
-    if (line[strlen(line) - 1] == '\n') {
-      line[strlen(line) - 1] = '\0';
-    }
+/**
+ * @brief Stop routing io_uring completions to a client that is closing
+ * shutting the socket down ends its multishot receive (a plain close does
+ * not, the pending request holds its own reference to the socket)
+ * @param client
+ */
+void uring_forget(struct Player *client) {
+  struct Worker *worker = client->room->worker;
+  if (worker == NULL || worker->ring.fd < 0) {
+    return;
+  }
+  shutdown(client->fd, SHUT_RDWR);
+  if (client->fd < worker->max_conns) {
+    worker->conns[client->fd] = NULL;
+  }
+  uring_orphan_send(worker, client);
+}
 
-    // return (separator line)
-    if (line_type == 0) {
-      // separator type (0)
-      if (strlen(line) > 0) {
-        parse_error(filename, line_num, "Expected separator line.");
-      }
-      line_type++;
-    }
+/**
+ * @brief Append a score event for room to the journal, if there is one
+ * only copies the record, the commit thread does the I/O. Every record the
+ * journal refuses (a commit failed, or it is closed) is logged.
+ * @param room
+ * @param record room is filled in
+ * @param name player name (JOURNAL_PLAYER), NULL otherwise
+ */
+void journal_event(struct Room *room, struct JournalRecord record,
+                   const char *name) {
+  if (ScoreJournal == NULL) {
+    return;
+  }
+  record.room = room->id;
+  if (journal_append(ScoreJournal, &record, name,
+                     name != NULL ? strlen(name) : 0) < 0) {
+    log_printf(LOG_ERROR,
+               "Journal record dropped (room %d, event %d, seat %d)\n",
+               room->id, record.type, record.seat);
+  }
+}
 
-    // prompt type (1)
-    else if (line_type == 1) {
-      if (strlen(line) < 2) {
-        parse_error(filename, line_num,
-                    "Expected prompt string (recieved empty line).");
+/**
+ * @brief Close every connection in a room and mark the game as ended
+ * queued output gets one last non-blocking flush (skipped while an
+ * io_uring send is in flight, it would write the same bytes again). The
+ * room itself is freed by its worker once the current batch of events has
+ * been dispatched
+ * @param room
+ */
+void end_room(struct Room *room) {
+  room->state.ended = 1;
+  if (room->state.started) {
+    int winner = -1;
+    leaderboard_top(&room->board, 1, &winner);
+    journal_event(room,
+                  (struct JournalRecord){
+                      .type = JOURNAL_END,
+                      .seat = winner,
+                      .question = room->state.question_number,
+                      .score = winner >= 0 ? room->board.score[winner] : 0},
+                  NULL);
+  }
+  if (room->worker != NULL) {
+    timer_cancel(&room->worker->wheel, &room->deadline);
+  }
+  for (int i = 0; i < room->max_players; i++) {
+    struct Player *client = &room->players[i];
+    if (client->fd != -1) {
+      if (!client->sending) {
+        outq_flush(&client->outbox, client->fd);
       }
-      strcpy(this_entry->prompt, line);
-      line_type++;
+      uring_forget(client);
+      shutdown(client->fd, SHUT_RDWR);
+      close(client->fd);
+      client->fd = -1;
     }
+    outq_clear(&client->outbox);
+  }
+}
 
-    // options type (2)
-    else if (line_type == 2) {
-      if (strlen(line) == 0) {
-        parse_error(filename, line_num,
-                    "Expected option string (recieved empty line).");
-      }
-
-      int length = split_option(this_entry->options, line, QUESTION_DELIM);
-      if (length != 4) {
-        parse_error(filename, line_num, "Invalid amount of options.");
-      }
-
-      line_type++;
-    }
+/**
+ * @brief Close a client's connection and drop its pending I/O
+ * closing the fd also removes it from any epoll set
+ * @param client
+ */
+void close_connection(struct Player *client) {
+  uring_forget(client);
+  close(client->fd);
+  client->fd = -1;
+  client->inbox.head = client->inbox.tail;
+  outq_clear(&client->outbox);
+}
 
-    // answer index type (3)
-    else if (line_type == 3) {
-      int set = 0;
-      for (int i = 0; i < 3; i++) {
-        if (strcmp(line, this_entry->options[i]) == 0) {
-          this_entry->answer_idx = i;
-          set = 1;
-        }
-      }
+/**
+ * @brief Account for a seat freed in a lobby
+ * @param room
+ */
+void leave_lobby(struct Room *room) {
+  room->seated--;
+  if (room == room->worker->lobby && room->seated < ROOM_MIN) {
+    timer_cancel(&room->worker->wheel, &room->lobby_timer);
+  }
+}
 
-      // error if supplied answer not in options
-      if (set != 1) {
-        parse_error(filename, line_num,
-                    "Supplied answer not defined in options.");
-      }
+/**
+ * @brief Close a client connection and mark its slot as empty
+ * a lobby seat is simply freed for the next connection. In a playing room
+ * the seat and score are kept so the player can come back with its
+ * session token; a room with no connections left is ended.
+ * @param client
+ */
+void drop_client(struct Player *client) {
+  log_printf(LOG_DEBUG, "[DEBUG]: Client lost connection.\n");
+  close_connection(client);
+  log_printf(LOG_INFO, "Lost connection!\n");
+
+  struct Room *room = client->room;
+  if (!room->state.clients_engaged) {
+    // still matchmaking
+    leave_lobby(room);
+    return;
+  }
 
-      line_type = 0;
-      entry_num++;
-      this_entry = &arr[entry_num];
+  room->seated--;
+  if (room->answered[client - room->players]) {
+    room->state.answers--;
+  }
+  if (room->seated > 0) {
+    // everyone left has answered (or registered), move the game on at
+    // the next tick (not here, a broadcast may be iterating the room)
+    if ((room->state.question_pending && all_answered(room)) ||
+        !room->state.started) {
+      arm_deadline(room, 0);
     }
+    return;
+  }
+  end_room(room);
+}
 
-    line_num++;
+/**
+ * @brief Toggle EPOLLOUT interest for a client
+ * write readiness is only watched while output is queued
+ * @param client
+ * @param want_write
+ */
+void set_write_interest(struct Player *client, int want_write) {
+  if (client->want_write == want_write) {
+    return;
   }
 
-  free(line);
-  fclose(fp);
-  return entry_num;
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET | (want_write ? EPOLLOUT : 0);
+  ev.data.ptr = client;
+  if (epoll_ctl(client->room->worker->epoll_fd, EPOLL_CTL_MOD, client->fd,
+                &ev) < 0) {
+    log_printf(LOG_ERROR, "epoll_ctl: %m\n");
+    return;
+  }
+  client->want_write = want_write;
 }
 
-void print_entry(struct Entry entry) {
-  printf("Prompt: %s\n", entry.prompt);
-  printf("Options: ");
-  for (int i = 0; i < 3; i++) {
-    printf("%s, ", entry.options[i]);
+/**
+ * @brief Put a client on its worker's send list
+ * everything queued for it until the end of the current wakeup leaves in
+ * one gathered write (an io_uring send is submitted once the one in
+ * flight completes)
+ * @param client
+ */
+void client_defer(struct Player *client) {
+  struct Worker *worker = client->room->worker;
+  if (!client->sending && !client->send_queued) {
+    client->send_queued = 1;
+    client->send_next = worker->sends;
+    worker->sends = client;
   }
-  printf("\n");
-  printf("Correct answer: %d (%s)\n", entry.answer_idx,
-         entry.options[entry.answer_idx]);
 }
 
-void print_question(char *prompt, char *options[3], int question_number) {
-  printf("Question %d: %s\n", question_number, prompt);
-  printf("Press 1: %s\n", options[0]);
-  printf("Press 2: %s\n", options[1]);
-  printf("Press 3: %s\n", options[2]);
+/**
+ * @brief Write out as much of a client's queue as the socket accepts
+ * @param client
+ * @return int -1 if the client was dropped, 0 otherwise
+ */
+int client_flush(struct Player *client) {
+  struct Worker *worker = client->room->worker;
+  if (worker->ring.fd >= 0) {
+    // sent in one batch when the worker next enters the kernel
+    client_defer(client);
+    return 0;
+  }
+
+  size_t queued = client->outbox.queued_bytes;
+  ssize_t remaining = outq_flush(&client->outbox, client->fd);
+  if (remaining < 0) {
+    drop_client(client);
+    return -1;
+  }
+  METRIC_ADD(worker->metrics.sends, 1);
+  METRIC_ADD(worker->metrics.bytes_out, queued - remaining);
+  set_write_interest(client, remaining > 0);
+  return 0;
 }
 
 /**
-  "Safe write"
-  continues writing until all bytes written
+ * @brief Queue a frame on one client
+ * the frame is written with the rest of the client's output at the end of
+ * the wakeup, so an answer, the standings and the next question produced
+ * by the same event leave in one write. A client whose queue grows past
+ * HIGH_WATER is a slow consumer and is dropped so it cannot stall the
+ * room. The caller keeps its reference.
+ * @param client
+ * @param frame
+ * @return int -1 if the client was dropped, 0 otherwise
  */
-ssize_t swrite(int fd, char *message) {
-  if (fd == -1) {
+int client_send(struct Player *client, struct OutBuf *frame) {
+  if (outq_push(&client->outbox, frame) < 0) {
+    drop_client(client);
     return -1;
   }
-  size_t written = 0;
-  size_t length = strlen(message);
-  while (written < length) {
-    ssize_t n = write(fd, message + written, length - written);
-    if (n < 0) {
-      perror("write");
-      return -1;
+  int type = frame->data[FRAME_HEADER] - '0';
+  if (type >= 0 && type < METRIC_TYPES) {
+    METRIC_ADD(client->room->worker->metrics.messages_out[type], 1);
+  }
+  client_defer(client);
+  if (client->outbox.queued_bytes > HIGH_WATER) {
+    log_printf(LOG_INFO, "Dropping slow client %s\n", client->name);
+    drop_client(client);
+    return -1;
+  }
+  return 0;
+}
+
+/**
+  Broadcase framed message to all clients in a room
+  the frame is encoded once and a reference is queued per client.
+ */
+void broadcast(struct Room *room, struct OutBuf *frame) {
+  if (frame == NULL) {
+    log_printf(LOG_ERROR, "Failed to allocate broadcast frame.\n");
+    return;
+  }
+
+  struct Metrics *metrics = &room->worker->metrics;
+  long long start = metrics_now();
+
+  for (int i = 0; i < room->max_players; i++) {
+    struct Player *client = &room->players[i];
+    if (client->fd == -1) {
+      continue;
     }
-    written += n;
+    client_send(client, frame);
   }
 
-  return written;
+  hist_record(&metrics->fanout, metrics_now() - start);
+
+  log_printf(LOG_DEBUG, "[DEBUG]: room %d broadcast:: %.*s\n", room->id,
+             (int)(frame->length - FRAME_HEADER), frame->data + FRAME_HEADER);
+
+  // queues hold their own references
+  outbuf_release(frame);
+}
+
+/**
+ * @brief Append one leaderboard slot ("pos:score:name") to a change list
+ * separators in names are replaced so the list stays parseable
+ */
+size_t append_slot(char *dest, size_t size, size_t used, int pos, int score,
+                   const char *name) {
+  if (used >= size) {
+    return used;
+  }
+  int n = snprintf(dest + used, size - used, "%s%d:%d:", used ? "," : "", pos,
+                   score);
+  if (n < 0 || used + n >= size) {
+    return size;
+  }
+  used += n;
+  for (const char *c = name; *c != 0 && used < size - 1; c++) {
+    dest[used++] = (*c == ',' || *c == ':') ? '_' : *c;
+  }
+  dest[used] = 0;
+  return used;
 }
 
 /**
-  Broadcase message to all clients
+ * @brief Push every player its rank, score and the top-K changes
+ * LEADERBOARD frames are "rank|score|changes" where changes lists the top
+ * slots that differ from the last push as pos:score:name (a bare pos
+ * means the slot emptied), comma separated
+ * @param room
  */
-void broadcast(struct Player clients[MAX_CLIENTS], char *message) {
-  for (int i = 0; i < MAX_CLIENTS; i++) {
-    if (clients[i].fd != -1) {
-      swrite(clients[i].fd, message);
+void push_leaderboard(struct Room *room) {
+  struct Leaderboard *board = &room->board;
+  int top[LEADERBOARD_K];
+  int count = leaderboard_top(board, LEADERBOARD_K, top);
+
+  char changes[LEADERBOARD_K * 160];
+  size_t used = 0;
+  changes[0] = 0;
+  for (int i = 0; i < count; i++) {
+    int score = board->score[top[i]];
+    if (i < room->top_count && room->top[i] == top[i] &&
+        room->top_score[i] == score) {
+      continue;
+    }
+    used = append_slot(changes, sizeof(changes), used, i + 1, score,
+                       room->players[top[i]].name);
+    room->top[i] = top[i];
+    room->top_score[i] = score;
+  }
+  for (int i = count; i < room->top_count && used < sizeof(changes); i++) {
+    int n = snprintf(changes + used, sizeof(changes) - used, "%s%d",
+                     used ? "," : "", i + 1);
+    used = n < 0 ? sizeof(changes) : used + n;
+  }
+  room->top_count = count;
+
+  for (int i = 0; i < room->max_players; i++) {
+    struct Player *client = &room->players[i];
+    if (client->fd == -1) {
+      continue;
+    }
+    struct OutBuf *frame =
+        outbuf_printf("%d|%d|%d|%s", LEADERBOARD, leaderboard_rank(board, i),
+                      board->score[i], changes);
+    if (frame == NULL) {
+      log_printf(LOG_ERROR, "Failed to allocate leaderboard frame.\n");
+      return;
     }
+    client_send(client, frame);
+    outbuf_release(frame);
   }
+}
 
-  if (DEBUG) {
-    printf("[DEBUG]: broadcast:: %s\n", message);
+/**
+ * @brief Send a player its session token and where its game stands
+ * SESSION frames are "token|questions_done|score|rank". An open question
+ * the player has not answered is not done: it is sent again after the
+ * snapshot, and clients number questions by counting them.
+ * @param client
+ * @return int -1 if the client was dropped, 0 otherwise
+ */
+int send_session(struct Player *client) {
+  struct Room *room = client->room;
+  struct GameState *state = &room->state;
+  int player = client - room->players;
+  int done = state->question_number +
+             (state->question_pending && room->answered[player]);
+  struct OutBuf *frame = outbuf_printf(
+      "%d|%016llx|%d|%d|%d", SESSION, (unsigned long long)client->token,
+      done, room->board.score[player], leaderboard_rank(&room->board, player));
+  if (frame == NULL) {
+    log_printf(LOG_ERROR, "Failed to allocate session frame.\n");
+    return 0;
   }
+  int status = client_send(client, frame);
+  outbuf_release(frame);
+  return status;
+}
 
-  // prevent tcp message merging (happens sometimes if messages sent too
-  // quickly)
-  usleep(2 * 1000);
+/**
+ * @brief Tell a reconnecting client its token was not recognised
+ * it joins the next game as a new player. Written straight to the socket,
+ * which has nothing else queued and may be on its way to another worker's
+ * lobby.
+ * @param fd
+ */
+void reject_resume(int fd) {
+  struct OutBuf *frame = outbuf_printf("%d||0|0|0", SESSION);
+  if (frame != NULL) {
+    send(fd, frame->data, frame->length, MSG_NOSIGNAL | MSG_DONTWAIT);
+    outbuf_release(frame);
+  }
 }
 
 /**
   Handle game state and events
  */
-void game_event(struct Player clients[MAX_CLIENTS]) {
-  if (Game_State.started == 0) {
+void game_event(struct Room *room) {
+  struct GameState *state = &room->state;
+  struct Player *clients = room->players;
+
+  // lobbies wait for matchmaking to start them
+  if (!state->clients_engaged) {
+    return;
+  }
+
+  if (state->started == 0) {
     // check if all players registered names
+    int num_connected = 0;
     int num_registered = 0;
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-      if (DEBUG) {
-        printf("[DEBUG]: client names: %s\n", clients[i].name);
+    for (int i = 0; i < room->max_players; i++) {
+      if (clients[i].fd == -1) {
+        continue;
       }
+      log_printf(LOG_DEBUG, "[DEBUG]: client names: %s\n", clients[i].name);
 
-      if (strlen(clients[i].name) > 0) {
+      num_connected++;
+      if (clients[i].name[0] != 0) {
         num_registered++;
       }
     }
 
     // all clients registered, start game
-    if (DEBUG) {
-      printf("[DEBUG]: number registered: %d\n", num_registered);
-    }
-    if (num_registered == MAX_CLIENTS) {
-      printf("The game starts now!\n");
-      Game_State.started = 1;
-      game_event(clients);
+    log_printf(LOG_DEBUG, "[DEBUG]: number registered: %d\n", num_registered);
+    if (num_connected > 0 && num_registered == num_connected) {
+      log_printf(LOG_INFO, "The game starts now! (room %d)\n", room->id);
+      state->started = 1;
+      journal_event(room,
+                    (struct JournalRecord){.type = JOURNAL_START,
+                                           .seat = num_connected,
+                                           .question = state->question_total,
+                                           .seed = state->order.seed},
+                    NULL);
+      for (int i = 0; i < room->max_players; i++) {
+        if (clients[i].fd != -1) {
+          journal_event(room,
+                        (struct JournalRecord){.type = JOURNAL_PLAYER,
+                                               .seat = i},
+                        clients[i].name);
+        }
+      }
+      game_event(room);
     }
 
     /**
     Game started
      */
   } else {
-    // if all questions answered, print winner and exit
-    if (Game_State.question_number == Game_State.question_total) {
-      Game_State.ended = 1;
-      int winner;
-      int max_score = Game_State.question_total * -1; // lowest possible score
-      for (int i = 0; i < MAX_CLIENTS; i++) {
-        if (clients[i].score > max_score) {
-          winner = i;
-          max_score = clients[i].score;
-        }
-      }
+    // if all questions answered, print winner and end room
+    if (state->question_number == state->question_total) {
+      // ties go to whoever reached the top score first
+      int winner = 0;
+      leaderboard_top(&room->board, 1, &winner);
 
       // print winner
-      printf("Congrats, %s!\n", clients[winner].name);
+      log_printf(LOG_INFO, "Congrats, %s!\n", clients[winner].name);
 
       // tell everyone to leave
-      char command_buffer[1024];
-      snprintf(command_buffer, 1024, "%d\\", FECKOFF);
-      broadcast(clients, command_buffer);
-
-      // clean up and exit
-      for (int i = 0; i < MAX_CLIENTS; i++) {
-        if (clients[i].fd != -1) {
-          shutdown(clients[i].fd, SHUT_RDWR);
-          close(clients[i].fd);
-        }
-      }
+      broadcast(room, outbuf_printf("%d", FECKOFF));
 
+      // clean up
+      end_room(room);
     }
     // if no pending question, ask
-    else if (Game_State.question_pending == 0) {
-      Game_State.active_question =
-          Game_State.question_set[Game_State.question_number];
+    else if (state->question_pending == 0) {
+      state->active_question =
+          shuffle_get(&state->order, state->question_number);
 
       // print active question to screen
-      char *options[3] = {Game_State.active_question.options[0],
-                          Game_State.active_question.options[1],
-                          Game_State.active_question.options[2]};
-      print_question(Game_State.active_question.prompt, options,
-                     Game_State.question_number + 1);
-
-      // broadcast question to all clients
-      char command_buffer[1024];
-      memset(command_buffer, 0, sizeof(command_buffer));
-      snprintf(command_buffer, 1024, "%d|%d|%s|%s|%s|%s\\", QUESTION_SEND,
-               Game_State.question_number, Game_State.active_question.prompt,
-               Game_State.active_question.options[0],
-               Game_State.active_question.options[1],
-               Game_State.active_question.options[2]);
-
-      // broadcast message to all clients
-      broadcast(clients, command_buffer);
+      struct Entry entry;
+      bank_get(state->bank, state->active_question, &entry);
+      print_question(entry.prompt, entry.options, state->question_number + 1);
+
+      // open the question until everyone answers or the window closes
+      memset(room->answered, 0, room->max_players);
+      state->answers = 0;
+      state->question_pending = 1;
+      if (ANSWER_WINDOW_MS > 0) {
+        arm_deadline(room, ANSWER_WINDOW_MS);
+      }
+
+      // broadcast the question's pre-encoded frame to all clients
+      state->question_sent_at = metrics_now();
+      broadcast(room, bank_question_frame(state->bank, state->active_question));
     } else {
       // take no action till question answered
     }
@@ -417,172 +871,1420 @@ void game_event(struct Player clients[MAX_CLIENTS]) {
 }
 
 /**
-  handle client sockets and multiplexing
+ * @brief Close the active question: reveal the answer and ask the next one
+ * @param room
  */
-void client_handler(struct Player clients[MAX_CLIENTS]) {
-  // send client name query
-  char command_buffer[1024];
-  memset(command_buffer, 0, sizeof(command_buffer));
-  snprintf(command_buffer, 1024, "%d\\", NAME_QUERY);
-  broadcast(clients, command_buffer);
-  Game_State.clients_engaged = 1;
-
-  // set up read loop
-  // use fd set write read fds for client returns
-  char buffer[1024];
-  memset(buffer, 0, sizeof(buffer));
-  fd_set readfds;
-  int max_fd = 0;
+void end_question(struct Room *room) {
+  struct GameState *state = &room->state;
+  timer_cancel(&room->worker->wheel, &room->deadline);
+
+  // broadcast correct answer and the new standings
+  broadcast(room, bank_answer_frame(state->bank, state->active_question));
+  if (state->ended) {
+    return;
+  }
+  push_leaderboard(room);
+  if (state->ended) {
+    return;
+  }
 
-  while (1) {
-    struct Player *active_client;
+  // queue next question
+  state->question_pending = 0;
+  state->question_number++;
+  game_event(room);
+}
 
-    // set up multiplex
-    FD_ZERO(&readfds);
+/**
+ * @brief Deadline timer callback
+ * also re-checks registration when a player left before the game started
+ * @param arg struct Room
+ */
+void question_deadline(void *arg) {
+  struct Room *room = arg;
+  if (room->state.ended) {
+    return;
+  }
+  if (!room->state.started) {
+    game_event(room);
+  } else if (room->state.question_pending) {
+    end_question(room);
+  }
+}
 
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-      if (clients[i].fd > -1) {
-        FD_SET(clients[i].fd, &readfds);
-        if (clients[i].fd > max_fd) {
-          max_fd = clients[i].fd;
-        }
-      }
-    }
+void resume_client(struct Player *client, uint64_t token);
 
-    int selecting = select(max_fd + 1, &readfds, NULL, NULL, NULL);
-    if (DEBUG) {
-      printf("select result: %d\n", selecting);
-    }
+/**
+  Handle one complete message from a client
+  payload is a view into the client's inbox and is tokenized in place
+ */
+void handle_message(struct Player *active_client, char *payload,
+                    size_t length) {
+  struct Room *room = active_client->room;
+  struct GameState *state = &room->state;
+
+  // parse return
+  struct Field args[MAX_FIELDS];
+  int type = parse_message(payload, length, args);
+  if (type < 0) {
+    log_printf(LOG_ERROR, "Recieved malformed message! %.*s\n", (int)length,
+               payload);
+    return;
+  }
+  struct Metrics *metrics = &room->worker->metrics;
+  if (type < METRIC_TYPES) {
+    METRIC_ADD(metrics->messages_in[type], 1);
+  }
 
-    if (selecting < 0) {
-      // safe case for when game ends
-      // (client sockets close and select fails)
-      if (Game_State.ended) {
-        return;
-      }
+  switch (type) {
+  // name return
+  case NAME_RETURN: {
+    size_t name_len = args[1].len;
+    if (name_len == 0) {
+      // an empty name would leave the player unregistered
+      break;
     }
-
-    // find ready client
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-      if (FD_ISSET(clients[i].fd, &readfds) && clients[i].fd != -1) {
-        active_client = &clients[i];
-      }
+    if (name_len > NAME_MAX_LEN) {
+      name_len = NAME_MAX_LEN;
     }
-
-    // read from active client
-    int n;
-    int abort = 0;
-    while (buffer[strlen(buffer) - 1] != SOCK_END) {
-      int amount = read(active_client->fd, buffer, 1024);
-      if (amount < 1) {
-        // client disconnected
-        abort = 1;
+    // a longer name than the last one gets new room in the pool; unnamed
+    // seats share the read-only "", so they always take this branch
+    if (name_len > strlen(active_client->name)) {
+      char *name = arena_strndup(&room->names, args[1].ptr, name_len);
+      if (name == NULL) {
+        log_printf(LOG_ERROR, "Failed to allocate player name.\n");
         break;
-      } else {
-        n += amount;
       }
+      active_client->name = name;
+    } else {
+      memcpy(active_client->name, args[1].ptr, name_len);
+      active_client->name[name_len] = 0;
     }
-
-    if (abort) {
-      if (DEBUG) {
-        printf("[DEBUG]: Client lost connection.\n");
+    log_printf(LOG_INFO, "Hi %s!\n", active_client->name);
+
+    // registered players can reconnect with their session token
+    if (state->clients_engaged && active_client->token == 0) {
+      active_client->token = session_new_token();
+      if (session_put(&Sessions, active_client->token, room->worker->id,
+                      active_client) < 0) {
+        log_printf(LOG_ERROR, "Failed to record session.\n");
+        active_client->token = 0;
+      } else if (send_session(active_client) < 0) {
+        break;
       }
-      close(active_client->fd);
-      active_client->fd = -1;
-      printf("Lost connection!\n");
-      continue;
     }
+    game_event(room);
+  } break;
+
+  // question response
+  case QUESTION_RESPONSE: {
+    // one answer per player, only while the question is open
+    int player = active_client - room->players;
+    if (!state->question_pending || room->answered[player]) {
+      break;
+    }
+    room->answered[player] = 1;
+    if (state->answers++ == 0) {
+      hist_record(&metrics->answer_latency,
+                  metrics_now() - state->question_sent_at);
+    }
+    log_printf(LOG_DEBUG, "[DEBUG]: Recieve answer: %.*s\n", (int)args[1].len,
+               args[1].ptr);
+    // check if answer was correct, scores live on the room's leaderboard
+    int choice = field_int(args[1]);
+    int delta;
+    if ((choice - 1) == bank_answer(state->bank, state->active_question)) {
+      log_printf(LOG_DEBUG, "[DEBUG]: Answer correct! +1 ==> %s\n",
+                 active_client->name);
+      delta = 1;
+    } else {
+      log_printf(LOG_DEBUG, "[DEBUG]: Answer incorrect. -1 ==> %s\n",
+                 active_client->name);
+      delta = -1;
+    }
+    leaderboard_update(&room->board, player, delta);
+    journal_event(room,
+                  (struct JournalRecord){.type = JOURNAL_ANSWER,
+                                         .seat = player,
+                                         .question = state->question_number,
+                                         .choice = choice,
+                                         .delta = delta,
+                                         .score = room->board.score[player],
+                                         .entry = state->active_question},
+                  NULL);
+
+    if (all_answered(room)) {
+      end_question(room);
+    }
+  } break;
 
-    // trim delimiter from buffer
-    buffer[strlen(buffer) - 1] = 0;
-
-    // parse return
-    char args[128][1024];
-    int num_args = split_by_delim(args, buffer, SOCK_DELIM);
-    if (num_args < 1) {
-      fprintf(stderr, "Recieved no arguments! %s\n", buffer);
+  // reconnect: only a fresh connection still in the lobby can resume
+  case RESUME: {
+    if (state->clients_engaged || active_client->token != 0) {
+      break;
     }
+    resume_client(active_client,
+                  session_parse_token(args[1].ptr, args[1].len));
+  } break;
+  }
+}
 
-    switch (atoi(args[0])) {
-    // name return
-    case NAME_RETURN: {
-      printf("Hi %s!\n", args[1]);
-      strcpy(active_client->name, args[1]);
-      game_event(clients);
-    } break;
+/**
+ * @brief Handle every complete frame buffered in a client's inbox
+ * @param active_client
+ * @return int -1 if the client was dropped, 0 otherwise
+ */
+int client_dispatch(struct Player *active_client) {
+  char scratch[INBOX_SIZE];
+  char *payload;
+  size_t payload_len;
+  int status;
+  while ((status = ring_next_frame(&active_client->inbox, scratch, &payload,
+                                   &payload_len)) == 1) {
+    handle_message(active_client, payload, payload_len);
+    if (active_client->fd == -1 || active_client->room->state.ended) {
+      return 0;
+    }
+  }
 
-    // question response
-    case QUESTION_RESPONSE: {
-      if (DEBUG) {
-        printf("[DEBUG]: Recieve answer: %s\n", args[1]);
-      }
-      // check if answer was correct
-      if ((atoi(args[1]) - 1) == Game_State.active_question.answer_idx) {
-        if (DEBUG) {
-          printf("[DEBUG]: Answer correct! +1 ==> %s\n", active_client->name);
-        }
-        active_client->score++;
-      } else {
-        if (DEBUG) {
-          printf("[DEBUG]: Answer incorrect. -1 ==> %s\n", active_client->name);
-        }
-        active_client->score--;
-      }
+  if (status < 0) {
+    // a single frame larger than the inbox is a protocol error
+    drop_client(active_client);
+    return -1;
+  }
+  return 0;
+}
 
-      // broadcast correct answer
-      char res_buffer[1024];
-      snprintf(res_buffer, 1024, "%d|%s\\", ANSWER_BROADCAST,
-               Game_State.active_question
-                   .options[Game_State.active_question.answer_idx]);
-      broadcast(clients, res_buffer);
+/**
+ * @brief Drain a readable client socket (edge-triggered)
+ * reads until EAGAIN into the client's ring buffer, dispatching every
+ * complete frame after each read. Returns -1 if the client was dropped,
+ * 0 otherwise.
+ * @param active_client
+ * @return int
+ */
+int client_readable(struct Player *active_client) {
+  while (active_client->fd != -1) {
+    ssize_t amount =
+        ring_fill(&active_client->inbox, active_client->fd, MSG_DONTWAIT);
+    if (amount < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      // socket drained, wait for next edge
+      return 0;
+    }
+    if (amount < 0 && errno == EINTR) {
+      continue;
+    }
+    if (amount < 1) {
+      // client disconnected
+      drop_client(active_client);
+      return -1;
+    }
+    METRIC_ADD(active_client->room->worker->metrics.bytes_in, amount);
 
-      // queue next question
-      Game_State.question_pending = 0;
-      Game_State.question_number++;
-      game_event(clients);
-    } break;
+    // dispatch every complete frame in the ring
+    if (client_dispatch(active_client) < 0) {
+      return -1;
     }
   }
+
+  return 0;
 }
 
-int main(int argc, char **argv) {
-  char question_file[STRLEN];
-  char ip[STRLEN];
-  int port = 25555;
-  int help = 0;
+void lobby_deadline(void *arg);
 
-  // set up game state
-  memset(&Game_State, 0, sizeof(Game_State));
-  Game_State.started = 0;
-  Game_State.question_number = 0;
-  Game_State.ended = 0;
+/**
+ * @brief Take a reference on a bank for a room or worker
+ * only called by a thread that already holds a reference (or before the
+ * bank is published), so the count never comes back from zero
+ * @param bank
+ */
+void retain_bank(struct QuestionBank *bank) {
+  __atomic_fetch_add(&bank->refs, 1, __ATOMIC_RELAXED);
+}
 
-  // set up string argument defaults
-  strcpy(question_file, DEFAULT_QUESTION_FILE);
-  strcpy(ip, DEFAULT_IP);
+/**
+ * @brief Drop a reference, the last one frees the bank
+ * @param bank
+ */
+void release_bank(struct QuestionBank *bank) {
+  if (__atomic_sub_fetch(&bank->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+    log_printf(LOG_INFO, "Retired a question bank (%d questions)\n",
+               bank->count);
+    bank_free(bank);
+    free(bank);
+  }
+}
 
-  /**
-   * parse process arguments
-   */
-  int opt;
-  opterr = 0;
-  while ((opt = getopt(argc, argv, "i:p:f:h")) != -1) {
-    switch (opt) {
-    case 'i': {
-      if (strlen(optarg) >= STRLEN) {
-        failwith("IP argument too long");
-      }
-      if (strlen(optarg) < 3) {
-        failwith("IP Argument expects valid IP");
-      }
-      memset(ip, 0, sizeof(char) * STRLEN);
-      strcpy(ip, optarg);
-    } break;
+/**
+ * @brief Point a room that has not started at a bank and draw its question
+ * order: GAME_QUESTIONS (or all) distinct questions, shuffled by a seed
+ * derived from ORDER_SEED and the room id, so a room can be replayed
+ * @param room
+ * @param bank
+ */
+void deal_questions(struct Room *room, struct QuestionBank *bank) {
+  struct GameState *state = &room->state;
+  state->bank = bank;
+  state->question_total = bank->count;
+  if (GAME_QUESTIONS > 0 && GAME_QUESTIONS < bank->count) {
+    state->question_total = GAME_QUESTIONS;
+  }
+  shuffle_init(&state->order, bank->count,
+               shuffle_mix(ORDER_SEED ^ shuffle_mix(room->id)));
+}
 
-    case 'p': {
-      port = atoi(optarg);
-      if (port == 0) {
-        failwith("Invalid port");
+/**
+ * @brief Allocate an empty room on a worker that plays through the given
+ * questions. It starts out as the worker's lobby
+ * @param worker
+ * @param bank
+ * @return struct Room*
+ */
+struct Room *new_room(struct Worker *worker, struct QuestionBank *bank) {
+  struct Room *room = calloc(1, sizeof(struct Room));
+  if (room == NULL) {
+    failwith("Failed to allocate room.");
+  }
+  room->players = calloc(ROOM_MAX, sizeof(struct Player));
+  room->answered = calloc(ROOM_MAX, sizeof(uint8_t));
+  if (room->players == NULL || room->answered == NULL) {
+    failwith("Failed to allocate room.");
+  }
+  arena_init(&room->names);
+  room->id = __atomic_fetch_add(&RoomCount, 1, __ATOMIC_RELAXED);
+  room->max_players = ROOM_MAX;
+  room->worker = worker;
+  deal_questions(room, bank);
+  retain_bank(bank);
+  timer_init(&room->lobby_timer, lobby_deadline, room);
+  timer_init(&room->deadline, question_deadline, room);
+  if (leaderboard_init(&room->board, ROOM_MAX) < 0) {
+    failwith("Failed to allocate leaderboard.");
+  }
+  for (int i = 0; i < room->max_players; i++) {
+    room->players[i].fd = -1;
+    room->players[i].name = "";
+    room->players[i].room = room;
+    outq_init(&room->players[i].outbox);
+  }
+  return room;
+}
+
+/**
+ * @brief Start a multishot receive for a player on an io_uring worker
+ * @param worker
+ * @param client
+ * @return int 0 on success, -1 if no submission entry was free
+ */
+int uring_recv(struct Worker *worker, struct Player *client) {
+  struct io_uring_sqe *sqe = uring_sqe(&worker->ring);
+  if (sqe == NULL) {
+    return -1;
+  }
+  uring_prep_recv(sqe, client->fd, worker->bufs.group,
+                  URING_DATA(client->gen, client->fd, URING_RECV));
+  return 0;
+}
+
+/**
+ * @brief Start watching a player's socket on the worker's event loop
+ * @param worker
+ * @param client
+ * @return int 0 on success, -1 on failure
+ */
+int watch_client(struct Worker *worker, struct Player *client) {
+  // a seat may be reused or resumed while its last socket waited for
+  // EPOLLOUT; the new socket is added without it
+  client->want_write = 0;
+  if (worker->ring.fd >= 0) {
+    if (client->fd >= worker->max_conns) {
+      errno = EMFILE;
+      return -1;
+    }
+    client->gen = worker->next_gen++;
+    worker->conns[client->fd] = client;
+    return uring_recv(worker, client);
+  }
+
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+  ev.data.ptr = client;
+  return epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, client->fd, &ev);
+}
+
+/**
+ * @brief Stop watching a player's socket without closing it
+ * a multishot receive is cancelled synchronously so it cannot consume
+ * bytes meant for the worker the socket moves to
+ * @param worker
+ * @param client
+ * @return int 0 on success, -1 on failure
+ */
+int unwatch_client(struct Worker *worker, struct Player *client) {
+  if (worker->ring.fd >= 0) {
+    struct io_uring_sqe *sqe = uring_sqe(&worker->ring);
+    if (sqe == NULL) {
+      return -1;
+    }
+    uring_prep_cancel(sqe, URING_DATA(client->gen, client->fd, URING_RECV),
+                      URING_DATA(0, 0, URING_CANCEL));
+    worker->conns[client->fd] = NULL;
+    uring_orphan_send(worker, client);
+    return uring_submit(&worker->ring, 0) < 0 ? -1 : 0;
+  }
+
+  return epoll_ctl(worker->epoll_fd, EPOLL_CTL_DEL, client->fd, NULL);
+}
+
+void route_connection(struct Worker *worker, int client_fd);
+int detach_client(struct Player *client);
+
+/**
+ * @brief Grace timer callback: start a closed lobby
+ * the lobby's players are already watched by the worker; they get the
+ * name query that starts the room. If players who resumed elsewhere left
+ * it short of ROOM_MIN, the rest go back to the open lobby instead.
+ * @param arg struct Room
+ */
+void start_room(void *arg) {
+  struct Room *room = arg;
+  if (room->seated < ROOM_MIN) {
+    for (int i = 0; i < room->max_players; i++) {
+      if (room->players[i].fd != -1) {
+        int fd = detach_client(&room->players[i]);
+        if (fd >= 0) {
+          route_connection(room->worker, fd);
+        }
+      }
+    }
+    end_room(room);
+    return;
+  }
+
+  for (int i = 0; i < room->max_players; i++) {
+    if (room->players[i].fd != -1) {
+      leaderboard_add(&room->board, i);
+    }
+  }
+
+  // send client name query
+  room->state.clients_engaged = 1;
+  broadcast(room, outbuf_printf("%d", NAME_QUERY));
+}
+
+/**
+ * @brief Close the worker's lobby to new players and open a new lobby
+ * the closed lobby starts RESUME_GRACE_MS later, so a reconnecting player
+ * that filled it can still leave with its RESUME. New players go to the
+ * next worker's lobby from here on, so rooms are spread over the workers.
+ * @param worker
+ */
+void close_lobby(struct Worker *worker) {
+  struct Room *room = worker->lobby;
+  timer_cancel(&worker->wheel, &room->lobby_timer);
+  room->next = worker->rooms;
+  worker->rooms = room;
+  worker->num_rooms++;
+  worker->lobby = new_room(worker, worker->bank);
+  // only the worker owning the open lobby moves it on
+  __atomic_store_n(&LobbyWorker, (worker->id + 1) % NumWorkers,
+                   __ATOMIC_RELEASE);
+
+  timer_init(&room->lobby_timer, start_room, room);
+  arm_timer(worker, &room->lobby_timer, RESUME_GRACE_MS);
+}
+
+/**
+ * @brief Lobby timer callback: start the lobby if it still holds
+ * ROOM_MIN players
+ * @param arg struct Room
+ */
+void lobby_deadline(void *arg) {
+  struct Room *room = arg;
+  if (room == room->worker->lobby && room->seated >= ROOM_MIN) {
+    log_printf(LOG_INFO, "Lobby timer expired! (room %d, %d players)\n",
+               room->id, room->seated);
+    close_lobby(room->worker);
+  }
+}
+
+/**
+ * @brief Free every ended room owned by a worker
+ * only called between event batches so no pending event can still point at
+ * a freed player
+ * @param worker
+ */
+void reap_rooms(struct Worker *worker) {
+  struct Room **link = &worker->rooms;
+  while (*link != NULL) {
+    struct Room *room = *link;
+    if (room->state.ended) {
+      *link = room->next;
+      worker->num_rooms--;
+      log_printf(LOG_DEBUG, "[DEBUG]: worker %d closed room %d\n", worker->id,
+                 room->id);
+      for (int i = 0; i < room->max_players; i++) {
+        session_remove(&Sessions, room->players[i].token);
+        ring_free(&room->players[i].inbox);
+        outq_clear(&room->players[i].outbox);
+        free(room->players[i].send);
+      }
+      leaderboard_free(&room->board);
+      release_bank(room->state.bank);
+      arena_free(&room->names);
+      free(room->answered);
+      free(room->players);
+      free(room);
+    } else {
+      link = &room->next;
+    }
+  }
+}
+
+/**
+ * @brief Give a new connection the next seat in the worker's lobby
+ * the lobby closes as soon as it is full, or LOBBY_WAIT_MS after it
+ * reached ROOM_MIN players, and starts RESUME_GRACE_MS later
+ * @param worker
+ * @param client_fd
+ */
+struct Player *seat_client(struct Worker *worker, int client_fd) {
+  // add client to room roster
+  struct Room *room = worker->lobby;
+  int seat = 0;
+  while (room->players[seat].fd != -1) {
+    seat++;
+  }
+  struct Player *client = &room->players[seat];
+  if (client->inbox.data == NULL &&
+      ring_init(&client->inbox, INBOX_SIZE) < 0) {
+    failwith("Failed to allocate client buffer.");
+  }
+  client->inbox.head = client->inbox.tail = 0;
+  client->name = "";
+  room->answered[seat] = 0;
+  client->fd = client_fd;
+  room->seated++;
+
+  // output is already gathered per wakeup, Nagle would only hold back the
+  // next one until the previous is acknowledged
+  int one = 1;
+  setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+  log_printf(LOG_INFO, "New connection detected!\n");
+
+  // watch the socket right away so players leaving the lobby are noticed
+  if (watch_client(worker, client) < 0) {
+    log_printf(LOG_ERROR, "watch_client: %m\n");
+    drop_client(client);
+    return NULL;
+  }
+
+  if (room->seated == room->max_players) {
+    log_printf(LOG_INFO, "Max connection reached! (room %d)\n", room->id);
+    close_lobby(worker);
+  } else if (room->seated >= ROOM_MIN && !timer_armed(&room->lobby_timer)) {
+    arm_timer(worker, &room->lobby_timer, LOBBY_WAIT_MS);
+  }
+  return client->fd != -1 ? client : NULL;
+}
+
+/**
+ * @brief Reattach a reconnected socket to the player owning `token`
+ * runs on the player's worker. The old connection is closed if its loss
+ * went unnoticed; the player gets its session snapshot and, if it has not
+ * answered yet, the open question again. A token whose room has ended in
+ * the meantime joins the open lobby as a new player.
+ * @param worker
+ * @param token
+ * @param fd
+ */
+void attach_session(struct Worker *worker, uint64_t token, int fd) {
+  struct Session session;
+  struct Player *client = NULL;
+  if (session_get(&Sessions, token, &session) &&
+      session.worker == worker->id) {
+    client = session.player;
+  }
+  if (client == NULL || client->room->state.ended) {
+    reject_resume(fd);
+    route_connection(worker, fd);
+    return;
+  }
+
+  struct Room *room = client->room;
+  int player = client - room->players;
+  if (client->fd != -1) {
+    close_connection(client);
+  } else {
+    // counted out when its connection was dropped
+    room->seated++;
+    room->state.answers += room->answered[player];
+  }
+  client->fd = fd;
+  client->inbox.head = client->inbox.tail = 0;
+  if (watch_client(worker, client) < 0) {
+    log_printf(LOG_ERROR, "watch_client: %m\n");
+    drop_client(client);
+    return;
+  }
+  log_printf(LOG_INFO, "%s is back! (room %d)\n", client->name,
+             client->room->id);
+
+  struct GameState *state = &client->room->state;
+  if (send_session(client) < 0) {
+    return;
+  }
+  if (state->question_pending && !room->answered[player]) {
+    client_send(client,
+                bank_question_frame(state->bank, state->active_question));
+  }
+}
+
+/**
+ * @brief Queue work for a worker and wake it
+ * @param worker
+ * @param handoff
+ */
+void post_mail(struct Worker *worker, struct Handoff *handoff) {
+  pthread_mutex_lock(&worker->mail_lock);
+  handoff->next = worker->mail;
+  worker->mail = handoff;
+  pthread_mutex_unlock(&worker->mail_lock);
+
+  uint64_t one = 1;
+  if (write(worker->mail_fd, &one, sizeof(one)) < 0) {
+    log_printf(LOG_ERROR, "eventfd write: %m\n");
+  }
+}
+
+/**
+ * @brief Queue a socket for another worker and wake it
+ * @param worker
+ * @param token the session it resumes, 0 for a new connection
+ * @param fd
+ */
+void post_handoff(struct Worker *worker, uint64_t token, int fd) {
+  struct Handoff *handoff = calloc(1, sizeof(struct Handoff));
+  if (handoff == NULL) {
+    log_printf(LOG_ERROR, "Failed to allocate handoff.\n");
+    close(fd);
+    return;
+  }
+  handoff->token = token;
+  handoff->fd = fd;
+  post_mail(worker, handoff);
+}
+
+/**
+ * @brief Seat a new connection in the open lobby, handing it to the
+ * worker that owns the lobby if that is not this one
+ * @param worker
+ * @param client_fd
+ */
+void route_connection(struct Worker *worker, int client_fd) {
+  int owner = __atomic_load_n(&LobbyWorker, __ATOMIC_ACQUIRE);
+  if (owner == worker->id) {
+    seat_client(worker, client_fd);
+  } else {
+    post_handoff(&Workers[owner], 0, client_fd);
+  }
+}
+
+/**
+ * @brief Start new rooms on a reloaded bank
+ * rooms already playing keep the bank they started with. The lobby has
+ * not asked anything yet, so it moves to the new bank too.
+ * @param worker
+ * @param bank arrives with a reference for the worker
+ */
+void swap_bank(struct Worker *worker, struct QuestionBank *bank) {
+  struct QuestionBank *old = worker->bank;
+  worker->bank = bank;
+
+  struct Room *lobby = worker->lobby;
+  if (lobby->state.bank == old) {
+    retain_bank(bank);
+    deal_questions(lobby, bank);
+    release_bank(old);
+  }
+  release_bank(old);
+}
+
+/**
+ * @brief Handle everything other threads posted to this worker, oldest
+ * first
+ * @param worker
+ */
+void worker_mail(struct Worker *worker) {
+  uint64_t count;
+  read(worker->mail_fd, &count, sizeof(count));
+
+  pthread_mutex_lock(&worker->mail_lock);
+  struct Handoff *handoff = worker->mail;
+  worker->mail = NULL;
+  pthread_mutex_unlock(&worker->mail_lock);
+
+  // posted newest first, two reloads must land in order
+  struct Handoff *oldest = NULL;
+  while (handoff != NULL) {
+    struct Handoff *next = handoff->next;
+    handoff->next = oldest;
+    oldest = handoff;
+    handoff = next;
+  }
+
+  while (oldest != NULL) {
+    struct Handoff *next = oldest->next;
+    if (oldest->bank != NULL) {
+      swap_bank(worker, oldest->bank);
+    } else if (oldest->token == 0) {
+      // the lobby may have moved on again while this was queued
+      route_connection(worker, oldest->fd);
+    } else {
+      attach_session(worker, oldest->token, oldest->fd);
+    }
+    free(oldest);
+    oldest = next;
+  }
+}
+
+/**
+ * @brief Take a lobby connection out of this worker's event loop and free
+ * its seat, keeping the socket open
+ * @param client
+ * @return int the socket, -1 if the client had to be dropped
+ */
+int detach_client(struct Player *client) {
+  int fd = client->fd;
+  if (unwatch_client(client->room->worker, client) < 0) {
+    log_printf(LOG_ERROR, "unwatch_client: %m\n");
+    drop_client(client);
+    return -1;
+  }
+  client->fd = -1;
+  client->inbox.head = client->inbox.tail;
+  outq_clear(&client->outbox);
+  leave_lobby(client->room);
+  return fd;
+}
+
+/**
+ * @brief Take a lobby connection that sent RESUME out of this worker's
+ * event loop and give its socket to the player the token belongs to
+ * @param client
+ * @param token
+ */
+void resume_client(struct Player *client, uint64_t token) {
+  struct Worker *worker = client->room->worker;
+  struct Session session;
+  if (!session_get(&Sessions, token, &session)) {
+    reject_resume(client->fd);
+    return;
+  }
+
+  int fd = detach_client(client);
+  if (fd < 0) {
+    return;
+  }
+
+  if (session.worker == worker->id) {
+    attach_session(worker, token, fd);
+  } else {
+    post_handoff(&Workers[session.worker], token, fd);
+  }
+}
+
+/**
+ * @brief Accept pending connections on the worker's own listener
+ * at most ACCEPT_BATCH connections are taken per call (the listener is
+ * level-triggered) so a connection burst cannot starve the rooms already
+ * playing.
+ * @param worker
+ */
+void worker_accept(struct Worker *worker) {
+  for (int n = 0; n < ACCEPT_BATCH; n++) {
+    int client_fd = accept4(worker->listen_fd, NULL, NULL, SOCK_NONBLOCK);
+    if (client_fd == -1) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        log_printf(LOG_ERROR, "accept: %m\n");
+      }
+      return;
+    }
+    METRIC_ADD(worker->metrics.accepts, 1);
+    route_connection(worker, client_fd);
+  }
+}
+
+/**
+ * @brief Write every deferred player's output, one gathered write each
+ * runs once per wakeup on epoll workers. Players waiting for EPOLLOUT are
+ * skipped, the socket is full and the event flushes them.
+ * @param worker
+ */
+void flush_sends(struct Worker *worker) {
+  while (worker->sends != NULL) {
+    struct Player *client = worker->sends;
+    worker->sends = client->send_next;
+    client->send_queued = 0;
+    if (client->fd == -1 || client->want_write || client->outbox.count == 0) {
+      continue;
+    }
+    client_flush(client);
+  }
+}
+
+/**
+  handle client sockets and multiplexing for every room on a worker
+  edge-triggered epoll: every ready fd is served in one wakeup, and the
+  interest list is kept by the kernel so it is not rebuilt per iteration
+ */
+void *client_handler(void *arg) {
+  struct Worker *worker = arg;
+  struct epoll_event events[MAX_EVENTS];
+
+  while (1) {
+    int ready = epoll_wait(worker->epoll_fd, events, MAX_EVENTS, -1);
+    log_printf(LOG_DEBUG, "[DEBUG]: worker %d epoll result: %d\n", worker->id,
+               ready);
+
+    if (ready < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      log_printf(LOG_ERROR, "epoll_wait: %m\n");
+      break;
+    }
+    METRIC_ADD(worker->metrics.wakeups, 1);
+
+    // serve every ready client in this wakeup
+    for (int i = 0; i < ready; i++) {
+      struct Player *active_client = events[i].data.ptr;
+
+      // question deadlines
+      if (events[i].data.ptr == &worker->wheel) {
+        uint64_t expirations;
+        read(worker->timer_fd, &expirations, sizeof(expirations));
+        wheel_advance(&worker->wheel, current_tick());
+        update_ticking(worker);
+        continue;
+      }
+
+      // reconnects from other workers
+      if (events[i].data.ptr == &worker->mail) {
+        worker_mail(worker);
+        continue;
+      }
+
+      // new connections
+      if (active_client == NULL) {
+        worker_accept(worker);
+        continue;
+      }
+
+      if (active_client->fd == -1 || active_client->room->state.ended) {
+        continue;
+      }
+      if (events[i].events & EPOLLOUT) {
+        if (client_flush(active_client) < 0) {
+          continue;
+        }
+      }
+      if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+        client_readable(active_client);
+      }
+    }
+
+    // output written while its rooms are still allocated
+    flush_sends(worker);
+    reap_rooms(worker);
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief Player a completion belongs to
+ * @param worker
+ * @param data completion user data
+ * @return struct Player* NULL if the connection has been dropped since
+ */
+struct Player *uring_player(struct Worker *worker, uint64_t data) {
+  int fd = (data >> 8) & 0xffffff;
+  struct Player *client = fd < worker->max_conns ? worker->conns[fd] : NULL;
+  if (client == NULL || client->gen != (uint32_t)(data >> 32)) {
+    return NULL;
+  }
+  return client;
+}
+
+/**
+ * @brief Turn every queued player's output into one gathered send
+ * runs once per completion batch: all frames queued for a player during
+ * the batch leave in a single send, and every player's send goes to the
+ * kernel with the worker's next io_uring_enter
+ * @param worker
+ */
+void uring_flush_sends(struct Worker *worker) {
+  while (worker->sends != NULL) {
+    struct Player *client = worker->sends;
+    worker->sends = client->send_next;
+    client->send_queued = 0;
+    if (client->fd == -1 || client->sending || client->outbox.count == 0) {
+      continue;
+    }
+
+    if (client->send == NULL) {
+      client->send = malloc(sizeof(struct UringSend));
+    }
+    struct io_uring_sqe *sqe =
+        client->send != NULL ? uring_sqe(&worker->ring) : NULL;
+    if (sqe == NULL) {
+      drop_client(client);
+      continue;
+    }
+    struct UringSend *send = client->send;
+    memset(&send->msg, 0, sizeof(send->msg));
+    send->msg.msg_iov = send->iov;
+    send->msg.msg_iovlen =
+        outq_iov(&client->outbox, send->iov, URING_SEND_IOV);
+    uring_prep_sendmsg(sqe, client->fd, &send->msg, MSG_NOSIGNAL,
+                       URING_DATA(client->gen, client->fd, URING_SEND));
+    client->sending = 1;
+    METRIC_ADD(worker->metrics.sends, 1);
+  }
+}
+
+/**
+ * @brief Multishot receive completion
+ * copies the kernel's buffer into the player's inbox, dispatches complete
+ * frames and hands the buffer back
+ * @param worker
+ * @param data
+ * @param res
+ * @param flags
+ */
+void uring_received(struct Worker *worker, uint64_t data, int res,
+                    unsigned flags) {
+  struct Player *client = uring_player(worker, data);
+  char *buf = NULL;
+  unsigned short bid = 0;
+  if (flags & IORING_CQE_F_BUFFER) {
+    bid = flags >> IORING_CQE_BUFFER_SHIFT;
+    buf = uring_buf(&worker->bufs, bid);
+  }
+
+  if (client != NULL && res > 0) {
+    METRIC_ADD(worker->metrics.bytes_in, res);
+    size_t done = 0;
+    while (done < (size_t)res && client->fd != -1 &&
+           !client->room->state.ended) {
+      done += ring_put(&client->inbox, buf + done, res - done);
+      if (client_dispatch(client) < 0) {
+        break;
+      }
+    }
+  }
+  if (buf != NULL) {
+    uring_buf_recycle(&worker->bufs, bid);
+  }
+
+  if (client == NULL || client->fd == -1) {
+    return;
+  }
+  if (res == 0 || (res < 0 && res != -ENOBUFS)) {
+    // client disconnected
+    drop_client(client);
+    return;
+  }
+  // the kernel ends a multishot receive when it runs out of buffers
+  if (!(flags & IORING_CQE_F_MORE) && uring_recv(worker, client) < 0) {
+    drop_client(client);
+  }
+}
+
+/**
+ * @brief Free an orphaned send once the kernel is done with it
+ * @param worker
+ * @param data the send's completion
+ */
+void uring_release_orphan(struct Worker *worker, uint64_t data) {
+  int fd = (data >> 8) & 0xffffff;
+  uint32_t gen = data >> 32;
+  for (struct UringSend **link = &worker->orphans; *link != NULL;
+       link = &(*link)->next) {
+    struct UringSend *send = *link;
+    if (send->fd == fd && send->gen == gen) {
+      *link = send->next;
+      outq_clear(&send->frames);
+      free(send);
+      return;
+    }
+  }
+}
+
+/**
+ * @brief Send completion: release what was written and send the rest
+ * @param worker
+ * @param data
+ * @param res
+ */
+void uring_sent(struct Worker *worker, uint64_t data, int res) {
+  struct Player *client = uring_player(worker, data);
+  if (client == NULL) {
+    uring_release_orphan(worker, data);
+    return;
+  }
+  client->sending = 0;
+  if (res < 0) {
+    drop_client(client);
+    return;
+  }
+  outq_consume(&client->outbox, res);
+  METRIC_ADD(worker->metrics.bytes_out, res);
+  if (client->outbox.count > 0) {
+    client_flush(client);
+  }
+}
+
+/**
+ * @brief Arm a multishot accept, tick poll or mail poll on an io_uring
+ * worker
+ * @param worker
+ * @param op URING_ACCEPT, URING_TICK or URING_MAIL
+ */
+void uring_arm(struct Worker *worker, int op) {
+  struct io_uring_sqe *sqe = uring_sqe(&worker->ring);
+  if (sqe == NULL) {
+    failwith("io_uring submission queue is stuck.");
+  }
+  if (op == URING_ACCEPT) {
+    uring_prep_accept(sqe, worker->listen_fd, SOCK_NONBLOCK,
+                      URING_DATA(0, 0, URING_ACCEPT));
+  } else {
+    uring_prep_poll(sqe, op == URING_TICK ? worker->timer_fd : worker->mail_fd,
+                    POLLIN, URING_DATA(0, 0, op));
+  }
+}
+
+/**
+  io_uring event loop for a worker (-u)
+  the listener, the tick timer and every player are multishot requests, so
+  a worker only enters the kernel once per batch: that call submits every
+  send queued during the previous batch and waits for the next completions
+ */
+void *uring_handler(void *arg) {
+  struct Worker *worker = arg;
+  uring_arm(worker, URING_ACCEPT);
+  uring_arm(worker, URING_TICK);
+  uring_arm(worker, URING_MAIL);
+
+  while (1) {
+    if (uring_submit(&worker->ring, 1) < 0 && errno != EINTR &&
+        errno != EBUSY) {
+      log_printf(LOG_ERROR, "io_uring_enter: %m\n");
+      break;
+    }
+    METRIC_ADD(worker->metrics.wakeups, 1);
+
+    struct io_uring_cqe *cqe;
+    while ((cqe = uring_peek(&worker->ring)) != NULL) {
+      uint64_t data = cqe->user_data;
+      int res = cqe->res;
+      unsigned flags = cqe->flags;
+      uring_seen(&worker->ring);
+
+      switch (data & 0xff) {
+      case URING_RECV: {
+        uring_received(worker, data, res, flags);
+      } break;
+
+      case URING_SEND: {
+        uring_sent(worker, data, res);
+      } break;
+
+      // new connections
+      case URING_ACCEPT: {
+        if (res >= 0) {
+          METRIC_ADD(worker->metrics.accepts, 1);
+          route_connection(worker, res);
+        } else if (res != -ECONNABORTED && res != -EINTR) {
+          log_printf(LOG_ERROR, "accept: %s\n", strerror(-res));
+        }
+        if (!(flags & IORING_CQE_F_MORE)) {
+          uring_arm(worker, URING_ACCEPT);
+        }
+      } break;
+
+      // question deadlines
+      case URING_TICK: {
+        uint64_t expirations;
+        read(worker->timer_fd, &expirations, sizeof(expirations));
+        wheel_advance(&worker->wheel, current_tick());
+        update_ticking(worker);
+        if (!(flags & IORING_CQE_F_MORE)) {
+          uring_arm(worker, URING_TICK);
+        }
+      } break;
+
+      // reconnects from other workers
+      case URING_MAIL: {
+        worker_mail(worker);
+        if (!(flags & IORING_CQE_F_MORE)) {
+          uring_arm(worker, URING_MAIL);
+        }
+      } break;
+      }
+    }
+
+    // sends must be prepared while their rooms are still allocated
+    uring_flush_sends(worker);
+    reap_rooms(worker);
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief Open a non-blocking listener that shares its port with the
+ * listeners of the other workers (SO_REUSEPORT)
+ * @param sock_addr
+ * @return int listening socket
+ */
+int open_listener(struct sockaddr_in *sock_addr) {
+  int sock_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  if (sock_fd < 0) {
+    failwith("Failed to create socket.");
+  }
+
+  int one = 1;
+  if (setsockopt(sock_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0 ||
+      setsockopt(sock_fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0) {
+    failwith("Failed to set SO_REUSEPORT.");
+  }
+
+  // bind
+  if (bind(sock_fd, (const struct sockaddr *)sock_addr, sizeof(*sock_addr)) <
+      0) {
+    failwith("Bind failed.");
+  }
+
+  // listen
+  if (listen(sock_fd, BACKLOG) < 0) {
+    failwith("Listen failed.");
+  }
+  return sock_fd;
+}
+
+/**
+ * @brief Create a worker with its own event loop and listener
+ * its thread is started separately by start_worker: every worker must be
+ * set up before any of them runs, since a running worker may hand
+ * connections to any other
+ * @param worker
+ * @param id
+ * @param listen_fd
+ * @param bank
+ */
+void init_worker(struct Worker *worker, int id, int listen_fd,
+                 struct QuestionBank *bank) {
+  memset(worker, 0, sizeof(*worker));
+  worker->id = id;
+  worker->listen_fd = listen_fd;
+  worker->bank = bank;
+  worker->epoll_fd = -1;
+  worker->ring.fd = -1;
+  metrics_init(&worker->metrics);
+  metrics_register(&worker->metrics);
+
+  wheel_init(&worker->wheel, current_tick());
+  worker->lobby = new_room(worker, bank);
+  worker->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+  if (worker->timer_fd < 0) {
+    failwith("Failed to create timerfd.");
+  }
+  pthread_mutex_init(&worker->mail_lock, NULL);
+  worker->mail_fd = eventfd(0, EFD_NONBLOCK);
+  if (worker->mail_fd < 0) {
+    failwith("Failed to create eventfd.");
+  }
+
+  if (USE_URING) {
+    if (uring_init(&worker->ring, URING_ENTRIES) < 0 ||
+        uring_buf_ring_init(&worker->ring, &worker->bufs, 0, URING_BUFS,
+                            URING_BUF_SIZE) < 0) {
+      failwith("Failed to set up io_uring.");
+    }
+    struct rlimit limit;
+    getrlimit(RLIMIT_NOFILE, &limit);
+    worker->max_conns = limit.rlim_cur < (1 << 24) ? limit.rlim_cur : 1 << 24;
+    worker->conns = calloc(worker->max_conns, sizeof(struct Player *));
+    if (worker->conns == NULL) {
+      failwith("Failed to allocate connection table.");
+    }
+    return;
+  }
+
+  worker->epoll_fd = epoll_create1(0);
+  if (worker->epoll_fd < 0) {
+    failwith("Failed to create epoll instance.");
+  }
+
+  // NULL event data marks the listener
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.ptr = NULL;
+  if (epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, worker->listen_fd, &ev) < 0) {
+    failwith("Failed to register listener with epoll.");
+  }
+
+  // the wheel's address marks the tick timer
+  ev.events = EPOLLIN;
+  ev.data.ptr = &worker->wheel;
+  if (epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, worker->timer_fd, &ev) < 0) {
+    failwith("Failed to register timerfd with epoll.");
+  }
+
+  // the mailbox's address marks handed over reconnects and banks
+  ev.data.ptr = &worker->mail;
+  if (epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, worker->mail_fd, &ev) < 0) {
+    failwith("Failed to register eventfd with epoll.");
+  }
+}
+
+/**
+ * @brief Start a worker's event loop thread
+ * @param worker set up by init_worker
+ */
+void start_worker(struct Worker *worker) {
+  void *(*handler)(void *) = USE_URING ? uring_handler : client_handler;
+  if (pthread_create(&worker->thread, NULL, handler, worker) != 0) {
+    failwith("Failed to start worker thread.");
+  }
+}
+
+/**
+ * @brief Check that io_uring (with provided buffer rings) is usable here
+ * kernels before 5.19, seccomp sandboxes and io_uring_disabled all refuse
+ * it, and the server then keeps the epoll loop
+ * @return int 1 if usable, 0 otherwise (errno set)
+ */
+int uring_usable() {
+  struct Uring ring;
+  struct UringBufRing bufs;
+  if (uring_init(&ring, 8) < 0) {
+    return 0;
+  }
+  int usable = uring_buf_ring_init(&ring, &bufs, 0, 8, 64) == 0;
+  int saved = errno;
+  if (usable) {
+    uring_buf_ring_free(&ring, &bufs);
+  }
+  uring_free(&ring);
+  errno = saved;
+  return usable;
+}
+
+/**
+ * @brief Raise the open file limit to the hard maximum
+ * the default soft limit (often 1024) caps idle connections well below
+ * what a large audience game needs
+ */
+void raise_fd_limit() {
+  struct rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0 &&
+      limit.rlim_cur < limit.rlim_max) {
+    limit.rlim_cur = limit.rlim_max;
+    if (setrlimit(RLIMIT_NOFILE, &limit) < 0) {
+      log_printf(LOG_ERROR, "setrlimit: %m\n");
+    }
+  }
+}
+
+/**
+ * @brief Load a question bank: compiled banks are mapped as-is, text
+ * files are parsed
+ * @param filename
+ * @param num_threads parser threads for text files
+ * @return struct QuestionBank* NULL if it could not be loaded (reported)
+ */
+struct QuestionBank *load_bank(char *filename, int num_threads) {
+  struct QuestionBank *bank = malloc(sizeof(struct QuestionBank));
+  if (bank == NULL) {
+    log_printf(LOG_ERROR, "Failed to allocate question bank.\n");
+    return NULL;
+  }
+  if (bank_is_compiled(filename)) {
+    if (bank_map(bank, filename) < 0) {
+      free(bank);
+      return NULL;
+    }
+  } else {
+    if (read_questions(bank, filename, num_threads) < 0) {
+      free(bank);
+      return NULL;
+    }
+    if (bank->num_errors > 0) {
+      print_parse_errors(bank, filename);
+    }
+    if (bank->num_errors > bank->num_duplicates) {
+      log_printf(LOG_ERROR, "Skipped %d malformed questions.\n",
+                 bank->num_errors - bank->num_duplicates);
+    }
+    if (bank->num_duplicates > 0) {
+      log_printf(LOG_ERROR, "Dropped %d duplicate questions.\n",
+                 bank->num_duplicates);
+    }
+  }
+  log_printf(LOG_INFO,
+             "Loaded %d questions from %s (%zu bytes, %zu saved by "
+             "interning and deduplication)\n",
+             bank->count, filename, bank_memory(bank), bank->bytes_saved);
+  return bank;
+}
+
+struct Reloader {
+  char *question_file;
+  struct Worker *workers;
+  int num_workers;
+};
+
+/**
+ * @brief Signals taken by signal_handler
+ */
+void signal_set_init(sigset_t *set) {
+  sigemptyset(set);
+  sigaddset(set, SIGHUP);
+  sigaddset(set, SIGUSR1);
+  sigaddset(set, SIGUSR2);
+  sigaddset(set, SIGTERM);
+  sigaddset(set, SIGINT);
+}
+
+/**
+ * @brief Step the log level on SIGUSR1 (more) or SIGUSR2 (less)
+ */
+void change_log_level(int sig) {
+  int level = __atomic_load_n(&LogLevel, __ATOMIC_RELAXED);
+  if (sig == SIGUSR1 && level < LOG_DEBUG) {
+    level++;
+  } else if (sig == SIGUSR2 && level > LOG_ERROR) {
+    level--;
+  }
+  __atomic_store_n(&LogLevel, level, __ATOMIC_RELAXED);
+  log_printf(LOG_ERROR, "Log level %d\n", level);
+}
+
+/**
+ * @brief Reload the question bank on every SIGHUP and post it to every
+ * worker, change the log level on SIGUSR1/SIGUSR2 and shut down on
+ * SIGTERM/SIGINT (these signals are blocked in all other threads). A bank
+ * that fails to load, or has no questions, leaves the current one in
+ * place. Shutting down commits the journal first, so a normal stop loses
+ * no score event already appended.
+ * @param arg struct Reloader
+ */
+void *signal_handler(void *arg) {
+  struct Reloader *reloader = arg;
+  sigset_t set;
+  signal_set_init(&set);
+
+  for (;;) {
+    int sig;
+    if (sigwait(&set, &sig) != 0) {
+      continue;
+    }
+    if (sig == SIGTERM || sig == SIGINT) {
+      log_printf(LOG_INFO, "Shutting down.\n");
+      if (ScoreJournal != NULL) {
+        journal_close(ScoreJournal);
+      }
+      exit(0);
+    }
+    if (sig != SIGHUP) {
+      change_log_level(sig);
+      continue;
+    }
+    log_printf(LOG_INFO, "Reloading %s\n", reloader->question_file);
+    struct QuestionBank *bank =
+        load_bank(reloader->question_file, reloader->num_workers);
+    if (bank == NULL) {
+      log_printf(LOG_ERROR, "Reload failed, keeping the current questions.\n");
+      continue;
+    }
+    if (bank->count == 0) {
+      log_printf(LOG_ERROR, "Reloaded bank is empty, keeping the current "
+                            "questions.\n");
+      bank_free(bank);
+      free(bank);
+      continue;
+    }
+
+    // one reference per worker, dropped when its next bank arrives
+    bank->refs = reloader->num_workers;
+    for (int i = 0; i < reloader->num_workers; i++) {
+      struct Handoff *handoff = calloc(1, sizeof(struct Handoff));
+      if (handoff == NULL) {
+        log_printf(LOG_ERROR, "Failed to allocate handoff.\n");
+        release_bank(bank);
+        continue;
+      }
+      handoff->bank = bank;
+      post_mail(&reloader->workers[i], handoff);
+    }
+  }
+  return NULL;
+}
+
+int main(int argc, char **argv) {
+  char question_file[STRLEN];
+  char ip[STRLEN];
+  char compile_file[STRLEN];
+  char metrics_path[STRLEN];
+  char journal_path[STRLEN];
+  int port = 25555;
+  int num_workers = sysconf(_SC_NPROCESSORS_ONLN);
+  int help = 0;
+  int seeded = 0;
+
+  if (num_workers < 1) {
+    num_workers = 1;
+  }
+
+  // set up string argument defaults
+  strcpy(question_file, DEFAULT_QUESTION_FILE);
+  strcpy(ip, DEFAULT_IP);
+  memset(compile_file, 0, sizeof(char) * STRLEN);
+  memset(metrics_path, 0, sizeof(char) * STRLEN);
+  memset(journal_path, 0, sizeof(char) * STRLEN);
+
+  /**
+   * parse process arguments
+   */
+  int opt;
+  opterr = 0;
+  while ((opt = getopt(argc, argv,
+                       "i:p:f:t:w:c:m:d:b:un:x:l:j:g:q:s:v:h")) != -1) {
+    switch (opt) {
+    case 'i': {
+      if (strlen(optarg) >= STRLEN) {
+        failwith("IP argument too long");
+      }
+      if (strlen(optarg) < 3) {
+        failwith("IP Argument expects valid IP");
+      }
+      memset(ip, 0, sizeof(char) * STRLEN);
+      strcpy(ip, optarg);
+    } break;
+
+    case 'p': {
+      port = atoi(optarg);
+      if (port == 0) {
+        failwith("Invalid port");
       }
     } break;
 
@@ -594,6 +2296,110 @@ int main(int argc, char **argv) {
       strcpy(question_file, optarg);
     } break;
 
+    case 't': {
+      num_workers = atoi(optarg);
+      if (num_workers < 1) {
+        failwith("Invalid thread count");
+      }
+    } break;
+
+    case 'w': {
+      HIGH_WATER = strtoul(optarg, NULL, 10);
+      if (HIGH_WATER == 0) {
+        failwith("Invalid high-water mark");
+      }
+    } break;
+
+    case 'c': {
+      if (strlen(optarg) >= STRLEN) {
+        failwith("bank argument too long");
+      }
+      strcpy(compile_file, optarg);
+    } break;
+
+    case 'd': {
+      ANSWER_WINDOW_MS = (long long)(atof(optarg) * 1000);
+      if (ANSWER_WINDOW_MS < 0) {
+        failwith("Invalid answer window");
+      }
+    } break;
+
+    case 'b': {
+      BACKLOG = atoi(optarg);
+      if (BACKLOG < 1) {
+        failwith("Invalid backlog");
+      }
+    } break;
+
+    case 'm': {
+      if (strlen(optarg) >= STRLEN) {
+        failwith("metrics socket argument too long");
+      }
+      strcpy(metrics_path, optarg);
+    } break;
+
+    case 'u': {
+      USE_URING = 1;
+    } break;
+
+    case 'n': {
+      ROOM_MIN = atoi(optarg);
+      if (ROOM_MIN < 1) {
+        failwith("Invalid minimum room size");
+      }
+    } break;
+
+    case 'x': {
+      ROOM_MAX = atoi(optarg);
+      if (ROOM_MAX < 1) {
+        failwith("Invalid maximum room size");
+      }
+    } break;
+
+    case 'l': {
+      LOBBY_WAIT_MS = (long long)(atof(optarg) * 1000);
+      if (LOBBY_WAIT_MS < 0) {
+        failwith("Invalid lobby wait");
+      }
+    } break;
+
+    case 'j': {
+      if (strlen(optarg) >= STRLEN) {
+        failwith("journal argument too long");
+      }
+      strcpy(journal_path, optarg);
+    } break;
+
+    case 'g': {
+      JOURNAL_INTERVAL_MS = (long long)(atof(optarg) * 1000);
+      if (JOURNAL_INTERVAL_MS < 0) {
+        failwith("Invalid journal interval");
+      }
+    } break;
+
+    case 'q': {
+      GAME_QUESTIONS = atoi(optarg);
+      if (GAME_QUESTIONS < 1) {
+        failwith("Invalid question count");
+      }
+    } break;
+
+    case 's': {
+      char *end;
+      ORDER_SEED = strtoull(optarg, &end, 16);
+      if (*optarg == 0 || *end != 0) {
+        failwith("Seed expects a hex number");
+      }
+      seeded = 1;
+    } break;
+
+    case 'v': {
+      LogLevel = atoi(optarg);
+      if (LogLevel < LOG_ERROR || LogLevel > LOG_DEBUG) {
+        failwith("Invalid log level");
+      }
+    } break;
+
     case 'h': {
       help = 1;
     } break;
@@ -608,11 +2414,27 @@ int main(int argc, char **argv) {
   /**
    * DEBUG: Log arugments
    */
-  if (DEBUG) {
+  if (LogLevel >= LOG_DEBUG) {
     fprintf(stdout, "[DEBUG] ARGUMENTS:\n");
     fprintf(stdout, "|  quesiton_file: %s\n", question_file);
     fprintf(stdout, "|  ip: %s\n", ip);
     fprintf(stdout, "|  port: %d\n", port);
+    fprintf(stdout, "|  threads: %d\n", num_workers);
+    fprintf(stdout, "|  high_water: %zu\n", HIGH_WATER);
+    fprintf(stdout, "|  compile_file: %s\n", compile_file);
+    fprintf(stdout, "|  metrics_path: %s\n", metrics_path);
+    fprintf(stdout, "|  answer_window_ms: %lld\n", ANSWER_WINDOW_MS);
+    fprintf(stdout, "|  backlog: %d\n", BACKLOG);
+    fprintf(stdout, "|  io_uring: %d\n", USE_URING);
+    fprintf(stdout, "|  room_min: %d\n", ROOM_MIN);
+    fprintf(stdout, "|  room_max: %d\n", ROOM_MAX);
+    fprintf(stdout, "|  lobby_wait_ms: %lld\n", LOBBY_WAIT_MS);
+    fprintf(stdout, "|  journal_path: %s\n", journal_path);
+    fprintf(stdout, "|  journal_interval_ms: %lld\n", JOURNAL_INTERVAL_MS);
+    fprintf(stdout, "|  game_questions: %d\n", GAME_QUESTIONS);
+    fprintf(stdout, "|  order_seed: %016llx\n",
+            (unsigned long long)ORDER_SEED);
+    fprintf(stdout, "|  log_level: %d\n", LogLevel);
     fprintf(stdout, "|  help: %d\n", help);
   }
 
@@ -621,71 +2443,124 @@ int main(int argc, char **argv) {
     exit(0);
   }
 
-  // test parsing questions
-  struct Entry questions[50];
-  int num_questions = read_questions(questions, question_file);
-  Game_State.question_total = num_questions;
-  Game_State.question_set = questions;
+  if (ROOM_MIN > ROOM_MAX) {
+    failwith("Minimum room size is larger than the maximum");
+  }
+
+  raise_fd_limit();
+
+  // load questions (shared read-only by every room that starts on them)
+  struct QuestionBank *bank = load_bank(question_file, num_workers);
+  if (bank == NULL) {
+    failwith("Failed to load question bank.");
+  }
+
+  // question order, printed so a run can be replayed with -s
+  if (!seeded && getrandom(&ORDER_SEED, sizeof(ORDER_SEED), 0) !=
+                     sizeof(ORDER_SEED)) {
+    ORDER_SEED = (uint64_t)time(NULL) ^ ((uint64_t)getpid() << 32);
+  }
+
+  // compiler mode: write the bank out and exit
+  if (compile_file[0] != '\0') {
+    if (bank_compile(bank, compile_file) < 0) {
+      failwith("Failed to compile question bank.");
+    }
+    printf("Compiled %d questions into %s\n", bank->count, compile_file);
+    bank_free(bank);
+    free(bank);
+    exit(0);
+  }
 
   /**
    * @brief set up server (listen on port)
-   socket using domain -> AF_INET, type -> SOCK_STREAM, protocol -> 0?
+   one SO_REUSEPORT listener per worker, all bound to the same address
    */
-  int sock_fd = socket(AF_INET, SOCK_STREAM, 0);
-  if (sock_fd == 0) {
-    failwith("Failed to create socket.");
-  }
-
-  // create socket address struct
-  struct sockaddr_in incoming_sock_addr;
-  memset(&incoming_sock_addr, 0, sizeof(incoming_sock_addr));
   struct sockaddr_in sock_addr;
   memset(&sock_addr, 0, sizeof(sock_addr));
   sock_addr.sin_family = AF_INET;
   sock_addr.sin_addr.s_addr = inet_addr(ip);
   sock_addr.sin_port = htons(port);
 
-  // bind
-  if (bind(sock_fd, (const struct sockaddr *)&sock_addr, sizeof(sock_addr)) <
-      0) {
-    failwith("Bind failed.");
+  int *listeners = calloc(num_workers, sizeof(int));
+  for (int i = 0; i < num_workers; i++) {
+    listeners[i] = open_listener(&sock_addr);
   }
 
-  // listen
-  if (listen(sock_fd, MAX_CLIENTS) < 0) {
-    failwith("Listen failed.");
+  if (USE_URING && !uring_usable()) {
+    fprintf(stderr, "io_uring unavailable (%s), using epoll.\n",
+            strerror(errno));
+    USE_URING = 0;
   }
 
-  // print welcome message (given socket suceeded)
-  fprintf(stdout, "Welcome to 392 Trivia!\n");
-
-  // start listening for players
-  struct Player clients[MAX_CLIENTS];
-  socklen_t incoming_addr_size = sizeof(incoming_sock_addr);
-  for (int i = 0; i < MAX_CLIENTS; i++) {
-    int client_fd =
-        accept(sock_fd, (struct sockaddr *)&sock_addr, &incoming_addr_size);
-    if (client_fd == -1) {
-      failwith("Accept failed.");
+  // SIGHUP reloads the question bank and SIGUSR1/SIGUSR2 change the log
+  // level; only the signal thread takes them, so they are blocked before
+  // any other thread starts
+  sigset_t signal_set;
+  signal_set_init(&signal_set);
+  pthread_sigmask(SIG_BLOCK, &signal_set, NULL);
+
+  // live metrics for every thread
+  if (metrics_path[0] != 0 && metrics_serve(metrics_path) < 0) {
+    failwith("Failed to serve metrics.");
+  }
+
+  // durable score events, committed in groups off the answer path
+  struct Journal journal;
+  if (journal_path[0] != 0) {
+    if (journal_open(&journal, journal_path, JOURNAL_INTERVAL_MS,
+                     JOURNAL_BUFFER) < 0) {
+      failwith("Failed to open journal.");
     }
+    ScoreJournal = &journal;
+  }
 
-    // add client to clients array
-    struct Player new_client;
-    new_client.fd = client_fd;
-    memset(new_client.name, 0, 128);
-    clients[i] = new_client;
+  // game threads log through the writer from here on
+  if (log_start(STDOUT_FILENO, STDERR_FILENO) < 0) {
+    failwith("Failed to start the log writer.");
+  }
+
+  // print welcome message (given socket suceeded)
+  log_printf(LOG_INFO, "Welcome to 392 Trivia!\n");
+  log_printf(LOG_INFO, "Question order seed %016llx (replay with -s)\n",
+             (unsigned long long)ORDER_SEED);
 
-    printf("New connection detected!\n");
+  // start room workers, each accepts and plays its own rooms
+  if (session_table_init(&Sessions, 1024) < 0) {
+    failwith("Failed to allocate session table.");
+  }
+  struct Worker *workers = calloc(num_workers, sizeof(struct Worker));
+  Workers = workers;
+  NumWorkers = num_workers;
+  // one reference per worker, dropped when its next bank arrives
+  bank->refs = num_workers;
+  for (int i = 0; i < num_workers; i++) {
+    init_worker(&workers[i], i, listeners[i], bank);
+  }
+  for (int i = 0; i < num_workers; i++) {
+    start_worker(&workers[i]);
   }
 
-  printf("Max connection reached!\n");
-  client_handler(clients);
+  struct Reloader reloader = {question_file, workers, num_workers};
+  pthread_t signal_thread;
+  if (pthread_create(&signal_thread, NULL, signal_handler, &reloader) != 0) {
+    failwith("Failed to start signal thread.");
+  }
+  pthread_detach(signal_thread);
+  for (int i = 0; i < num_workers; i++) {
+    pthread_join(workers[i].thread, NULL);
+  }
 
   // server cleanup
-  for (int i = 0; i < 3; i++) {
-    close(clients[i].fd);
+  for (int i = 0; i < num_workers; i++) {
+    close(listeners[i]);
+  }
+  free(listeners);
+  free(workers);
+  session_table_free(&Sessions);
+  if (ScoreJournal != NULL) {
+    journal_close(ScoreJournal);
   }
-  close(sock_fd);
 
   return 0;
-}
\ No newline at end of file
+}
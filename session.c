@@ -0,0 +1,190 @@
+/**
+  Session tokens
+*/
+
+#include "session.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/random.h>
+#include <time.h>
+
+// marks a removed entry, probing continues past it
+#define TOMBSTONE UINT64_MAX
+
+/**
+ * @brief Mix a token into a table index (tokens are random, this only
+ * guards against a weak random source)
+ */
+static size_t hash_token(uint64_t token) {
+  token ^= token >> 33;
+  token *= 0xff51afd7ed558ccdULL;
+  token ^= token >> 33;
+  return (size_t)token;
+}
+
+int session_table_init(struct SessionTable *table, size_t capacity) {
+  size_t size = 16;
+  while (size < capacity) {
+    size *= 2;
+  }
+  table->slots = calloc(size, sizeof(struct Session));
+  if (table->slots == NULL) {
+    return -1;
+  }
+  table->capacity = size;
+  table->count = 0;
+  table->used = 0;
+  pthread_mutex_init(&table->lock, NULL);
+  return 0;
+}
+
+void session_table_free(struct SessionTable *table) {
+  free(table->slots);
+  table->slots = NULL;
+  table->capacity = 0;
+  table->count = 0;
+  table->used = 0;
+  pthread_mutex_destroy(&table->lock);
+}
+
+/**
+ * @brief Random token, never 0 or the tombstone value
+ */
+uint64_t session_new_token() {
+  uint64_t token = 0;
+  while (token == 0 || token == TOMBSTONE) {
+    if (getrandom(&token, sizeof(token), 0) != sizeof(token)) {
+      token = ((uint64_t)rand() << 32) ^ (uint64_t)rand() ^
+              (uint64_t)time(NULL);
+    }
+  }
+  return token;
+}
+
+/**
+ * @brief Slot holding token, or the empty slot that ends its probe
+ * (caller holds the lock)
+ */
+static struct Session *find_slot(struct SessionTable *table, uint64_t token) {
+  size_t mask = table->capacity - 1;
+  for (size_t i = hash_token(token) & mask;; i = (i + 1) & mask) {
+    struct Session *slot = &table->slots[i];
+    if (slot->token == token || slot->token == 0) {
+      return slot;
+    }
+  }
+}
+
+/**
+ * @brief Rebuild the table at `capacity`, dropping tombstones
+ * (caller holds the lock)
+ */
+static int rehash(struct SessionTable *table, size_t capacity) {
+  struct Session *old = table->slots;
+  size_t old_capacity = table->capacity;
+  table->slots = calloc(capacity, sizeof(struct Session));
+  if (table->slots == NULL) {
+    table->slots = old;
+    return -1;
+  }
+  table->capacity = capacity;
+  table->used = table->count;
+  for (size_t i = 0; i < old_capacity; i++) {
+    if (old[i].token != 0 && old[i].token != TOMBSTONE) {
+      *find_slot(table, old[i].token) = old[i];
+    }
+  }
+  free(old);
+  return 0;
+}
+
+/**
+ * @brief Record which worker and player own a token
+ * @return int 0 on success, -1 on allocation failure
+ */
+int session_put(struct SessionTable *table, uint64_t token, int worker,
+                void *player) {
+  pthread_mutex_lock(&table->lock);
+  // keep the load (tombstones included) at or below one half
+  if ((table->used + 1) * 2 > table->capacity) {
+    size_t capacity = table->capacity;
+    if ((table->count + 1) * 4 > capacity) {
+      capacity *= 2;
+    }
+    if (rehash(table, capacity) < 0) {
+      pthread_mutex_unlock(&table->lock);
+      return -1;
+    }
+  }
+
+  struct Session *slot = find_slot(table, token);
+  if (slot->token == 0) {
+    table->count++;
+    table->used++;
+  }
+  slot->token = token;
+  slot->worker = worker;
+  slot->player = player;
+  pthread_mutex_unlock(&table->lock);
+  return 0;
+}
+
+/**
+ * @brief Look a token up
+ * @return int 1 and the entry copied to dest if found, 0 otherwise
+ */
+int session_get(struct SessionTable *table, uint64_t token,
+                struct Session *dest) {
+  if (token == 0 || token == TOMBSTONE) {
+    return 0;
+  }
+  pthread_mutex_lock(&table->lock);
+  struct Session *slot = find_slot(table, token);
+  int found = slot->token == token;
+  if (found) {
+    *dest = *slot;
+  }
+  pthread_mutex_unlock(&table->lock);
+  return found;
+}
+
+void session_remove(struct SessionTable *table, uint64_t token) {
+  if (token == 0 || token == TOMBSTONE) {
+    return;
+  }
+  pthread_mutex_lock(&table->lock);
+  struct Session *slot = find_slot(table, token);
+  if (slot->token == token) {
+    slot->token = TOMBSTONE;
+    slot->player = NULL;
+    table->count--;
+  }
+  pthread_mutex_unlock(&table->lock);
+}
+
+/**
+ * @brief Parse a token as sent on the wire (hex, not NUL terminated)
+ * @return uint64_t 0 if str is not a token
+ */
+uint64_t session_parse_token(const char *str, size_t len) {
+  if (len == 0 || len > 16) {
+    return 0;
+  }
+  uint64_t token = 0;
+  for (size_t i = 0; i < len; i++) {
+    char c = str[i];
+    int digit;
+    if (c >= '0' && c <= '9') {
+      digit = c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+      digit = c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+      digit = c - 'A' + 10;
+    } else {
+      return 0;
+    }
+    token = (token << 4) | digit;
+  }
+  return token;
+}
@@ -0,0 +1,43 @@
+/**
+  Session tokens
+
+  A player gets a random 64-bit token when it registers its name. A
+  client that lost its connection presents the token on a new one to get
+  its seat (and score) back. Tokens live in one open-addressing hash table
+  shared by every worker, so a reconnect is found in O(1) whichever
+  worker's listener accepted it; the entry says which worker owns the
+  player, and only that worker ever touches the player itself.
+*/
+
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct Session {
+  uint64_t token; // 0 marks an empty slot
+  int worker;
+  void *player;
+};
+
+struct SessionTable {
+  pthread_mutex_t lock;
+  struct Session *slots;
+  size_t capacity; // power of two
+  size_t count;    // live entries
+  size_t used;     // live entries plus tombstones
+};
+
+int session_table_init(struct SessionTable *table, size_t capacity);
+void session_table_free(struct SessionTable *table);
+uint64_t session_new_token();
+int session_put(struct SessionTable *table, uint64_t token, int worker,
+                void *player);
+int session_get(struct SessionTable *table, uint64_t token,
+                struct Session *dest);
+void session_remove(struct SessionTable *table, uint64_t token);
+uint64_t session_parse_token(const char *str, size_t len);
+
+#endif
@@ -0,0 +1,69 @@
+/**
+  Seeded question order
+*/
+
+#include "shuffle.h"
+
+/**
+ * @brief splitmix64 finalizer, a well mixed 64-bit hash
+ */
+uint64_t shuffle_mix(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+/**
+ * @brief Set up the order of `count` items given by seed
+ * @param shuffle
+ * @param count
+ * @param seed
+ */
+void shuffle_init(struct Shuffle *shuffle, uint32_t count, uint64_t seed) {
+  shuffle->seed = seed;
+  shuffle->count = count;
+
+  // smallest even bit width whose domain holds every index
+  uint32_t bits = 2;
+  while (bits < 32 && ((uint64_t)1 << bits) < count) {
+    bits += 2;
+  }
+  shuffle->half_bits = bits / 2;
+
+  uint64_t key = seed;
+  for (int i = 0; i < SHUFFLE_ROUNDS; i++) {
+    key = shuffle_mix(key);
+    shuffle->keys[i] = key;
+  }
+}
+
+/**
+ * @brief One pass of the Feistel network over the power-of-two domain
+ */
+static uint32_t feistel(const struct Shuffle *shuffle, uint32_t x) {
+  uint32_t half = shuffle->half_bits;
+  uint32_t mask = ((uint32_t)1 << half) - 1;
+  uint32_t left = x >> half;
+  uint32_t right = x & mask;
+  for (int i = 0; i < SHUFFLE_ROUNDS; i++) {
+    uint32_t next = left ^ (shuffle_mix(right ^ shuffle->keys[i]) & mask);
+    left = right;
+    right = next;
+  }
+  return (left << half) | right;
+}
+
+/**
+ * @brief Item at position index of the order
+ * @param shuffle
+ * @param index below count
+ * @return uint32_t a distinct item in [0, count) for every index
+ */
+uint32_t shuffle_get(const struct Shuffle *shuffle, uint32_t index) {
+  uint32_t x = index;
+  do {
+    x = feistel(shuffle, x);
+  } while (x >= shuffle->count);
+  return x;
+}
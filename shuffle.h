@@ -0,0 +1,33 @@
+/**
+  Seeded question order
+
+  A room asks the questions of its bank in a random order without ever
+  materializing it: position i of the order is computed on demand by a
+  keyed pseudo-random permutation of [0, n). A small Feistel network
+  permutes the smallest even-bit power-of-two domain covering n, and
+  values that land outside [0, n) are fed through again (cycle walking),
+  which keeps it a permutation of [0, n). The domain is less than 4n, so
+  a lookup takes under 4 passes on average. A room keeps only the seed
+  and the derived round keys, whatever the size of the bank, and the same
+  seed always gives the same order.
+*/
+
+#ifndef SHUFFLE_H
+#define SHUFFLE_H
+
+#include <stdint.h>
+
+#define SHUFFLE_ROUNDS 4
+
+struct Shuffle {
+  uint64_t seed;
+  uint32_t count;     // n
+  uint32_t half_bits; // bits per Feistel half
+  uint64_t keys[SHUFFLE_ROUNDS];
+};
+
+void shuffle_init(struct Shuffle *shuffle, uint32_t count, uint64_t seed);
+uint32_t shuffle_get(const struct Shuffle *shuffle, uint32_t index);
+uint64_t shuffle_mix(uint64_t x);
+
+#endif
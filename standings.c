@@ -0,0 +1,361 @@
+/**
+  Journal reader
+  rebuilds every game's final standings from a server's score journal
+  (server -j). Scores are summed from the answers alone; a total that
+  disagrees with the score the server recorded is reported. Rooms the
+  journal never saw end (server stopped or crashed mid-game) are marked
+  unfinished.
+*/
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "journal.h"
+
+struct Seat {
+  char name[JOURNAL_NAME_MAX + 1];
+  int score;
+  int answers;
+  int correct;
+  int mismatches; // answers whose recorded score disagreed
+};
+
+struct Game {
+  int run;
+  int room;
+  int started;
+  int ended;
+  int questions; // in the game
+  int asked;     // when it ended
+  int winner;
+  int64_t start_ns;
+  uint64_t seed;
+  struct Seat *seats;
+  int num_seats;
+};
+
+struct Games {
+  struct Game *games;
+  int count;
+  int capacity;
+  int *by_room; // game index of each room in the current run, -1 if none
+  int num_rooms;
+  int run;
+};
+
+// room ids at or past this are taken as damage rather than grown into
+#define ROOM_LIMIT (1 << 24)
+// seat numbers (and START's player count) past this are damage too
+#define SEAT_LIMIT (1 << 16)
+
+int VERBOSE = 0;
+char *EVENT_NAMES[] = {"OPEN", "START", "PLAYER", "ANSWER", "END"};
+
+void failwith(char *message) {
+  fprintf(stderr, "Error: %s\n", message);
+  exit(1);
+}
+
+/**
+ * @brief print help doc with name of executable inserted
+ *
+ * @param execname
+ */
+void print_help(char *execname) {
+  printf("Usage: %s [-v] [-h] journal_file\n", execname);
+  printf("\n");
+  printf("  -v                  Print every journal record;\n");
+  printf("  -h                  Display this help info.\n");
+}
+
+/**
+ * @brief Format a wall clock time in ns as local time
+ */
+void format_time(int64_t time_ns, char *buf, size_t len) {
+  time_t secs = time_ns / 1000000000LL;
+  struct tm tm;
+  localtime_r(&secs, &tm);
+  strftime(buf, len, "%Y-%m-%d %H:%M:%S", &tm);
+}
+
+/**
+ * @brief The current run's game for room, created on first sight
+ */
+struct Game *find_game(struct Games *games, int room) {
+  if (room >= games->num_rooms) {
+    int num_rooms = games->num_rooms > 0 ? games->num_rooms : 64;
+    while (num_rooms <= room) {
+      num_rooms *= 2;
+    }
+    games->by_room = realloc(games->by_room, num_rooms * sizeof(int));
+    if (games->by_room == NULL) {
+      failwith("Out of memory");
+    }
+    for (int i = games->num_rooms; i < num_rooms; i++) {
+      games->by_room[i] = -1;
+    }
+    games->num_rooms = num_rooms;
+  }
+  if (games->by_room[room] != -1) {
+    return &games->games[games->by_room[room]];
+  }
+
+  if (games->count == games->capacity) {
+    games->capacity = games->capacity > 0 ? games->capacity * 2 : 64;
+    games->games =
+        realloc(games->games, games->capacity * sizeof(struct Game));
+    if (games->games == NULL) {
+      failwith("Out of memory");
+    }
+  }
+  struct Game *game = &games->games[games->count];
+  memset(game, 0, sizeof(*game));
+  game->run = games->run;
+  game->room = room;
+  game->winner = -1;
+  games->by_room[room] = games->count++;
+  return game;
+}
+
+/**
+ * @brief Seat of a game, the roster grows to fit it
+ */
+struct Seat *find_seat(struct Game *game, int seat) {
+  if (seat >= game->num_seats) {
+    game->seats = realloc(game->seats, (seat + 1) * sizeof(struct Seat));
+    if (game->seats == NULL) {
+      failwith("Out of memory");
+    }
+    memset(&game->seats[game->num_seats], 0,
+           (seat + 1 - game->num_seats) * sizeof(struct Seat));
+    game->num_seats = seat + 1;
+  }
+  return &game->seats[seat];
+}
+
+void print_record(const struct JournalRecord *record, const char *name,
+                  int name_len) {
+  char when[32];
+  format_time(record->time_ns, when, sizeof(when));
+  printf("%s.%03d %-6s", when, (int)(record->time_ns / 1000000 % 1000),
+         EVENT_NAMES[record->type]);
+  switch (record->type) {
+  case JOURNAL_START:
+    printf(" room %u, %d players, %d questions, seed %016llx\n",
+           record->room, record->seat, record->question,
+           (unsigned long long)record->seed);
+    break;
+  case JOURNAL_PLAYER:
+    printf(" room %u seat %d: %.*s\n", record->room, record->seat, name_len,
+           name);
+    break;
+  case JOURNAL_ANSWER:
+    printf(" room %u seat %d: question %d (entry %d), option %d, %+d => %d\n",
+           record->room, record->seat, record->question + 1, record->entry,
+           record->choice, record->delta, record->score);
+    break;
+  case JOURNAL_END:
+    printf(" room %u after %d questions, winner seat %d\n", record->room,
+           record->question, record->seat);
+    break;
+  default:
+    printf("\n");
+  }
+}
+
+/**
+ * @brief Apply one record to the games
+ */
+void replay(struct Games *games, const struct JournalRecord *record,
+            const char *name, int name_len) {
+  if (record->type == JOURNAL_OPEN) {
+    // room ids start over with every run
+    games->run++;
+    for (int i = 0; i < games->num_rooms; i++) {
+      games->by_room[i] = -1;
+    }
+    return;
+  }
+  // only END has no seat: a game without a winner
+  int min_seat = record->type == JOURNAL_END ? -1 : 0;
+  if (record->seat < min_seat || record->seat > SEAT_LIMIT) {
+    fprintf(stderr, "Skipping record with bad seat %d.\n", record->seat);
+    return;
+  }
+  if (record->room >= ROOM_LIMIT) {
+    fprintf(stderr, "Skipping record with bad room %u.\n", record->room);
+    return;
+  }
+
+  struct Game *game = find_game(games, record->room);
+  switch (record->type) {
+  case JOURNAL_START:
+    game->started = 1;
+    game->questions = record->question;
+    game->start_ns = record->time_ns;
+    game->seed = record->seed;
+    break;
+  case JOURNAL_PLAYER: {
+    struct Seat *seat = find_seat(game, record->seat);
+    memcpy(seat->name, name, name_len);
+    seat->name[name_len] = 0;
+  } break;
+  case JOURNAL_ANSWER: {
+    struct Seat *seat = find_seat(game, record->seat);
+    seat->score += record->delta;
+    seat->answers++;
+    seat->correct += record->delta > 0;
+    seat->mismatches += seat->score != record->score;
+  } break;
+  case JOURNAL_END:
+    game->ended = 1;
+    game->asked = record->question;
+    game->winner = record->seat;
+    break;
+  }
+}
+
+/**
+ * @brief Rank seats by score (best first), ties by seat
+ */
+int compare_seats(const void *a, const void *b, void *arg) {
+  const struct Seat *seats = arg;
+  const struct Seat *x = &seats[*(const int *)a];
+  const struct Seat *y = &seats[*(const int *)b];
+  if (x->score != y->score) {
+    return y->score - x->score;
+  }
+  return *(const int *)a - *(const int *)b;
+}
+
+void print_game(struct Game *game) {
+  char when[32] = "not started";
+  if (game->started) {
+    format_time(game->start_ns, when, sizeof(when));
+  }
+  printf("Run %d room %d (%s, seed %016llx): ", game->run, game->room, when,
+         (unsigned long long)game->seed);
+  if (!game->ended) {
+    printf("unfinished\n");
+  } else if (game->winner >= 0 && game->winner < game->num_seats) {
+    printf("%d/%d questions, winner %s\n", game->asked, game->questions,
+           game->seats[game->winner].name);
+  } else {
+    printf("%d/%d questions, no winner\n", game->asked, game->questions);
+  }
+
+  int *order = malloc(game->num_seats * sizeof(int));
+  if (order == NULL) {
+    failwith("Out of memory");
+  }
+  for (int i = 0; i < game->num_seats; i++) {
+    order[i] = i;
+  }
+  qsort_r(order, game->num_seats, sizeof(int), compare_seats, game->seats);
+  for (int i = 0; i < game->num_seats; i++) {
+    struct Seat *seat = &game->seats[order[i]];
+    printf("  %3d. %-20s %5d  (%d/%d correct)", i + 1, seat->name,
+           seat->score, seat->correct, seat->answers);
+    if (seat->mismatches > 0) {
+      printf("  %d answers disagree with the recorded score",
+             seat->mismatches);
+    }
+    printf("\n");
+  }
+  free(order);
+}
+
+int main(int argc, char **argv) {
+  int help = 0;
+
+  /**
+   * parse process arguments
+   */
+  int opt;
+  opterr = 0;
+  while ((opt = getopt(argc, argv, "vh")) != -1) {
+    switch (opt) {
+    case 'v': {
+      VERBOSE = 1;
+    } break;
+
+    case 'h': {
+      help = 1;
+    } break;
+
+    case '?': {
+      fprintf(stderr, "Error: Unknown option '-%c' recieved.\n", optopt);
+      exit(1);
+    } break;
+    }
+  }
+
+  if (help) {
+    print_help(argv[0]);
+    exit(0);
+  }
+  if (optind != argc - 1) {
+    print_help(argv[0]);
+    exit(1);
+  }
+  char *path = argv[optind];
+
+  int fd = open(path, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) < 0) {
+    perror(path);
+    exit(1);
+  }
+  size_t size = st.st_size;
+  if (size < sizeof(struct JournalHeader)) {
+    failwith("Not a journal");
+  }
+  char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (data == MAP_FAILED) {
+    perror(path);
+    exit(1);
+  }
+  close(fd);
+  if (journal_check_header((struct JournalHeader *)data) < 0) {
+    failwith("Not a journal (or an unsupported version)");
+  }
+
+  struct Games games;
+  memset(&games, 0, sizeof(games));
+  long records = 0;
+  size_t offset = sizeof(struct JournalHeader);
+  size_t len;
+  while ((len = journal_record_size(data + offset, size - offset)) > 0) {
+    struct JournalRecord record;
+    memcpy(&record, data + offset, sizeof(record));
+    const char *name = data + offset + sizeof(record);
+    int name_len = len - sizeof(record);
+    if (VERBOSE) {
+      print_record(&record, name, name_len);
+    }
+    replay(&games, &record, name, name_len);
+    offset += len;
+    records++;
+  }
+  if (offset < size) {
+    fprintf(stderr, "Ignoring %zu bytes of torn record at the end.\n",
+            size - offset);
+  }
+
+  printf("%ld records, %d runs, %d games\n", records, games.run, games.count);
+  for (int i = 0; i < games.count; i++) {
+    print_game(&games.games[i]);
+    free(games.games[i].seats);
+  }
+  free(games.games);
+  free(games.by_room);
+  munmap(data, size);
+  return 0;
+}
@@ -0,0 +1,144 @@
+/**
+  Hierarchical timer wheel
+*/
+
+#include "timer.h"
+
+#include <string.h>
+
+void wheel_init(struct TimerWheel *wheel, uint64_t now) {
+  memset(wheel, 0, sizeof(*wheel));
+  wheel->now = now;
+  for (int level = 0; level < WHEEL_LEVELS; level++) {
+    for (int slot = 0; slot < WHEEL_SLOTS; slot++) {
+      struct Timer *head = &wheel->slots[level][slot];
+      head->next = head->prev = head;
+    }
+  }
+}
+
+void timer_init(struct Timer *timer, void (*fn)(void *arg), void *arg) {
+  memset(timer, 0, sizeof(*timer));
+  timer->fn = fn;
+  timer->arg = arg;
+}
+
+int timer_armed(struct Timer *timer) { return timer->next != NULL; }
+
+static void link_timer(struct Timer *head, struct Timer *timer) {
+  timer->prev = head->prev;
+  timer->next = head;
+  head->prev->next = timer;
+  head->prev = timer;
+}
+
+static void unlink_timer(struct Timer *timer) {
+  timer->prev->next = timer->next;
+  timer->next->prev = timer->prev;
+  timer->next = timer->prev = NULL;
+}
+
+/**
+ * @brief File a timer into the level that covers its distance from now
+ */
+static void place(struct TimerWheel *wheel, struct Timer *timer) {
+  uint64_t expires = timer->expires;
+  if (expires < wheel->now) {
+    // already due, runs on the next tick
+    expires = wheel->now;
+  }
+
+  uint64_t delta = expires - wheel->now;
+  for (int level = 0; level < WHEEL_LEVELS; level++) {
+    int shift = level * WHEEL_BITS;
+    if (delta < (1ULL << (shift + WHEEL_BITS)) || level == WHEEL_LEVELS - 1) {
+      if (level == WHEEL_LEVELS - 1 && delta >> (shift + WHEEL_BITS)) {
+        // past the wheel's range, park in the furthest slot
+        expires = wheel->now + (1ULL << (shift + WHEEL_BITS)) - 1;
+      }
+      link_timer(&wheel->slots[level][(expires >> shift) & WHEEL_MASK], timer);
+      return;
+    }
+  }
+}
+
+/**
+ * @brief Arm (or re-arm) a timer to run at tick `expires`
+ * @param wheel
+ * @param timer
+ * @param expires
+ */
+void timer_schedule(struct TimerWheel *wheel, struct Timer *timer,
+                    uint64_t expires) {
+  if (timer_armed(timer)) {
+    unlink_timer(timer);
+    wheel->count--;
+  }
+  timer->expires = expires;
+  place(wheel, timer);
+  wheel->count++;
+}
+
+void timer_cancel(struct TimerWheel *wheel, struct Timer *timer) {
+  if (timer_armed(timer)) {
+    unlink_timer(timer);
+    wheel->count--;
+  }
+}
+
+/**
+ * @brief Move every timer in one upper-level slot down a level
+ * @return int the slot index, 0 means the next level is due as well
+ */
+static int cascade(struct TimerWheel *wheel, int level) {
+  int slot = (wheel->now >> (level * WHEEL_BITS)) & WHEEL_MASK;
+  struct Timer *head = &wheel->slots[level][slot];
+  struct Timer *timer = head->next;
+  head->next = head->prev = head;
+
+  while (timer != head) {
+    struct Timer *next = timer->next;
+    place(wheel, timer);
+    timer = next;
+  }
+  return slot;
+}
+
+/**
+ * @brief Run every timer due up to and including tick `now`
+ * callbacks may schedule or cancel any timer, including their own
+ * @param wheel
+ * @param now
+ */
+void wheel_advance(struct TimerWheel *wheel, uint64_t now) {
+  while (wheel->now <= now) {
+    int slot = wheel->now & WHEEL_MASK;
+    if (slot == 0) {
+      for (int level = 1; level < WHEEL_LEVELS; level++) {
+        if (cascade(wheel, level) != 0) {
+          break;
+        }
+      }
+    }
+
+    // detach the due list first so callbacks can re-arm freely
+    struct Timer *head = &wheel->slots[0][slot];
+    struct Timer due;
+    due.next = due.prev = &due;
+    if (head->next != head) {
+      due.next = head->next;
+      due.prev = head->prev;
+      due.next->prev = &due;
+      due.prev->next = &due;
+      head->next = head->prev = head;
+    }
+    wheel->now++;
+
+    while (due.next != &due) {
+      struct Timer *timer = due.next;
+      unlink_timer(timer);
+      wheel->count--;
+      timer->fn(timer->arg);
+    }
+  }
+}
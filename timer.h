@@ -0,0 +1,44 @@
+/**
+  Hierarchical timer wheel
+
+  Time advances in ticks. Each of WHEEL_LEVELS levels has WHEEL_SLOTS
+  slots; level n holds timers due within WHEEL_SLOTS^(n+1) ticks and is
+  cascaded one slot down into the level below as time reaches it. Adding
+  and cancelling a timer are O(1) list operations and a tick only touches
+  the slots it passes, so the cost does not grow with the number of armed
+  timers. Timers due past the top level's range are clamped to it.
+*/
+
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 4
+
+struct Timer {
+  struct Timer *next;
+  struct Timer *prev;
+  uint64_t expires; // tick
+  void (*fn)(void *arg);
+  void *arg;
+};
+
+struct TimerWheel {
+  uint64_t now; // next tick to run
+  int count;    // armed timers
+  struct Timer slots[WHEEL_LEVELS][WHEEL_SLOTS]; // list heads
+};
+
+void wheel_init(struct TimerWheel *wheel, uint64_t now);
+void timer_init(struct Timer *timer, void (*fn)(void *arg), void *arg);
+int timer_armed(struct Timer *timer);
+void timer_schedule(struct TimerWheel *wheel, struct Timer *timer,
+                    uint64_t expires);
+void timer_cancel(struct TimerWheel *wheel, struct Timer *timer);
+void wheel_advance(struct TimerWheel *wheel, uint64_t now);
+
+#endif
@@ -0,0 +1,298 @@
+/**
+  Minimal io_uring wrapper
+*/
+
+#include "uring.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/**
+ * @brief Create a ring with `entries` submission slots
+ * @param ring
+ * @param entries
+ * @return int 0 on success, -1 on failure (errno set, ENOSYS or EPERM when
+ * the kernel or a sandbox does not allow io_uring)
+ */
+int uring_init(struct Uring *ring, unsigned entries) {
+  memset(ring, 0, sizeof(*ring));
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  ring->fd = syscall(__NR_io_uring_setup, entries, &params);
+  if (ring->fd < 0) {
+    return -1;
+  }
+
+  ring->sq_map_size =
+      params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  ring->cq_map_size =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+  ring->sq_map = mmap(NULL, ring->sq_map_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+  ring->cq_map = mmap(NULL, ring->cq_map_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+  ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+  if (ring->sq_map == MAP_FAILED || ring->cq_map == MAP_FAILED ||
+      ring->sqes == MAP_FAILED) {
+    int saved = errno;
+    uring_free(ring);
+    errno = saved;
+    return -1;
+  }
+
+  char *sq = ring->sq_map;
+  ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+  ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+  ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+  ring->sq_mask = *(unsigned *)(sq + params.sq_off.ring_mask);
+  ring->sq_entries = params.sq_entries;
+  ring->sq_local_tail = *ring->sq_tail;
+
+  char *cq = ring->cq_map;
+  ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+  ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+  ring->cq_mask = *(unsigned *)(cq + params.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+  // the index array never changes, slot i always holds sqe i
+  for (unsigned i = 0; i < ring->sq_entries; i++) {
+    ring->sq_array[i] = i;
+  }
+  return 0;
+}
+
+void uring_free(struct Uring *ring) {
+  if (ring->sq_map != NULL && ring->sq_map != MAP_FAILED) {
+    munmap(ring->sq_map, ring->sq_map_size);
+  }
+  if (ring->cq_map != NULL && ring->cq_map != MAP_FAILED) {
+    munmap(ring->cq_map, ring->cq_map_size);
+  }
+  if (ring->sqes != NULL && ring->sqes != MAP_FAILED) {
+    munmap(ring->sqes, ring->sqes_size);
+  }
+  if (ring->fd >= 0) {
+    close(ring->fd);
+  }
+  memset(ring, 0, sizeof(*ring));
+  ring->fd = -1;
+}
+
+/**
+ * @brief Publish prepared entries and enter the kernel
+ * @param ring
+ * @param wait_nr completions to wait for, 0 only submits
+ * @return int entries submitted, -1 on error (errno set)
+ */
+int uring_submit(struct Uring *ring, unsigned wait_nr) {
+  unsigned to_submit = ring->sq_local_tail - *ring->sq_tail;
+  __atomic_store_n(ring->sq_tail, ring->sq_local_tail, __ATOMIC_RELEASE);
+  if (to_submit == 0 && wait_nr == 0) {
+    return 0;
+  }
+
+  ring->enters++;
+  return syscall(__NR_io_uring_enter, ring->fd, to_submit, wait_nr,
+                 wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+}
+
+/**
+ * @brief Next free submission entry, cleared
+ * a full submission ring is submitted first to make room
+ * @param ring
+ * @return struct io_uring_sqe* NULL if the ring could not be drained
+ */
+struct io_uring_sqe *uring_sqe(struct Uring *ring) {
+  unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+  if (ring->sq_local_tail - head >= ring->sq_entries) {
+    if (uring_submit(ring, 0) < 0) {
+      return NULL;
+    }
+    head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    if (ring->sq_local_tail - head >= ring->sq_entries) {
+      return NULL;
+    }
+  }
+
+  struct io_uring_sqe *sqe = &ring->sqes[ring->sq_local_tail & ring->sq_mask];
+  ring->sq_local_tail++;
+  memset(sqe, 0, sizeof(*sqe));
+  return sqe;
+}
+
+/**
+ * @brief Oldest unconsumed completion
+ * @param ring
+ * @return struct io_uring_cqe* NULL if none are ready
+ */
+struct io_uring_cqe *uring_peek(struct Uring *ring) {
+  unsigned head = *ring->cq_head;
+  if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+    return NULL;
+  }
+  return &ring->cqes[head & ring->cq_mask];
+}
+
+/**
+ * @brief Hand the completion returned by uring_peek back to the kernel
+ * @param ring
+ */
+void uring_seen(struct Uring *ring) {
+  __atomic_store_n(ring->cq_head, *ring->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Register `entries` buffers of `size` bytes as buffer group `group`
+ * @param ring
+ * @param bufs
+ * @param group
+ * @param entries power of two
+ * @param size
+ * @return int 0 on success, -1 on failure (errno set)
+ */
+int uring_buf_ring_init(struct Uring *ring, struct UringBufRing *bufs,
+                        unsigned short group, unsigned entries,
+                        unsigned size) {
+  memset(bufs, 0, sizeof(*bufs));
+  bufs->ring_size = entries * sizeof(struct io_uring_buf);
+  bufs->ring = mmap(NULL, bufs->ring_size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (bufs->ring == MAP_FAILED) {
+    bufs->ring = NULL;
+    return -1;
+  }
+  bufs->data = mmap(NULL, (size_t)entries * size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (bufs->data == MAP_FAILED) {
+    bufs->data = NULL;
+    uring_buf_ring_free(ring, bufs);
+    return -1;
+  }
+  bufs->entries = entries;
+  bufs->size = size;
+  bufs->group = group;
+
+  struct io_uring_buf_reg reg;
+  memset(&reg, 0, sizeof(reg));
+  reg.ring_addr = (uint64_t)(uintptr_t)bufs->ring;
+  reg.ring_entries = entries;
+  reg.bgid = group;
+  if (syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_PBUF_RING,
+              &reg, 1) < 0) {
+    int saved = errno;
+    uring_buf_ring_free(NULL, bufs);
+    errno = saved;
+    return -1;
+  }
+
+  for (unsigned i = 0; i < entries; i++) {
+    uring_buf_recycle(bufs, i);
+  }
+  return 0;
+}
+
+/**
+ * @brief Unregister (when ring is not NULL) and unmap a buffer ring
+ */
+void uring_buf_ring_free(struct Uring *ring, struct UringBufRing *bufs) {
+  if (ring != NULL && bufs->entries > 0) {
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.bgid = bufs->group;
+    syscall(__NR_io_uring_register, ring->fd, IORING_UNREGISTER_PBUF_RING,
+            &reg, 1);
+  }
+  if (bufs->ring != NULL) {
+    munmap(bufs->ring, bufs->ring_size);
+  }
+  if (bufs->data != NULL) {
+    munmap(bufs->data, (size_t)bufs->entries * bufs->size);
+  }
+  memset(bufs, 0, sizeof(*bufs));
+}
+
+char *uring_buf(struct UringBufRing *bufs, unsigned short bid) {
+  return bufs->data + (size_t)bid * bufs->size;
+}
+
+/**
+ * @brief Give buffer `bid` back to the kernel
+ */
+void uring_buf_recycle(struct UringBufRing *bufs, unsigned short bid) {
+  unsigned slot = bufs->tail & (bufs->entries - 1);
+  struct io_uring_buf *buf = &bufs->ring->bufs[slot];
+  buf->addr = (uint64_t)(uintptr_t)uring_buf(bufs, bid);
+  buf->len = bufs->size;
+  buf->bid = bid;
+  bufs->tail++;
+  __atomic_store_n(&bufs->ring->tail, bufs->tail, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Multishot accept: one completion per connection, each `res` is a
+ * new socket opened with `flags` (SOCK_NONBLOCK, SOCK_CLOEXEC)
+ */
+void uring_prep_accept(struct io_uring_sqe *sqe, int fd, int flags,
+                       uint64_t user_data) {
+  sqe->opcode = IORING_OP_ACCEPT;
+  sqe->fd = fd;
+  sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+  sqe->accept_flags = flags;
+  sqe->user_data = user_data;
+}
+
+/**
+ * @brief Multishot receive into buffers picked from buffer group `group`
+ */
+void uring_prep_recv(struct io_uring_sqe *sqe, int fd, unsigned short group,
+                     uint64_t user_data) {
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = fd;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = group;
+  sqe->user_data = user_data;
+}
+
+/**
+ * @brief One gathered send; msg and its iovecs must stay valid until the
+ * entry has been submitted
+ */
+void uring_prep_sendmsg(struct io_uring_sqe *sqe, int fd, struct msghdr *msg,
+                        int flags, uint64_t user_data) {
+  sqe->opcode = IORING_OP_SENDMSG;
+  sqe->fd = fd;
+  sqe->addr = (uint64_t)(uintptr_t)msg;
+  sqe->len = 1;
+  sqe->msg_flags = flags;
+  sqe->user_data = user_data;
+}
+
+/**
+ * @brief Multishot poll: a completion every time fd becomes ready for mask
+ */
+void uring_prep_poll(struct io_uring_sqe *sqe, int fd, unsigned mask,
+                     uint64_t user_data) {
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = fd;
+  sqe->len = IORING_POLL_ADD_MULTI;
+  sqe->poll32_events = mask;
+  sqe->user_data = user_data;
+}
+
+/**
+ * @brief Cancel the request submitted with user data `target`
+ */
+void uring_prep_cancel(struct io_uring_sqe *sqe, uint64_t target,
+                       uint64_t user_data) {
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->fd = -1;
+  sqe->addr = target;
+  sqe->user_data = user_data;
+}
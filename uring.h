@@ -0,0 +1,83 @@
+/**
+  Minimal io_uring wrapper
+
+  Talks to the kernel through the raw io_uring_setup / io_uring_enter /
+  io_uring_register syscalls so the server does not need liburing. Only
+  what the server's completion loop uses is covered: submission and
+  completion rings, a provided buffer ring for multishot receives, and
+  preparation helpers for the handful of opcodes involved.
+*/
+
+#ifndef URING_H
+#define URING_H
+
+#include <linux/io_uring.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+struct Uring {
+  int fd;
+  // submission ring
+  unsigned *sq_head;
+  unsigned *sq_tail;
+  unsigned *sq_array;
+  unsigned sq_mask;
+  unsigned sq_entries;
+  unsigned sq_local_tail; // prepared but not yet published
+  struct io_uring_sqe *sqes;
+  // completion ring
+  unsigned *cq_head;
+  unsigned *cq_tail;
+  unsigned cq_mask;
+  struct io_uring_cqe *cqes;
+  // mappings
+  void *sq_map;
+  size_t sq_map_size;
+  void *cq_map;
+  size_t cq_map_size;
+  size_t sqes_size;
+  unsigned long long enters; // io_uring_enter calls made
+};
+
+/**
+  Kernel-selected receive buffers (IORING_REGISTER_PBUF_RING).
+  A completion names the buffer it filled; it is handed back with
+  uring_buf_recycle once its bytes have been copied out.
+ */
+struct UringBufRing {
+  struct io_uring_buf_ring *ring;
+  size_t ring_size;
+  char *data;
+  unsigned entries; // power of two
+  unsigned size;    // bytes per buffer
+  unsigned short group;
+  unsigned short tail;
+};
+
+int uring_init(struct Uring *ring, unsigned entries);
+void uring_free(struct Uring *ring);
+struct io_uring_sqe *uring_sqe(struct Uring *ring);
+int uring_submit(struct Uring *ring, unsigned wait_nr);
+struct io_uring_cqe *uring_peek(struct Uring *ring);
+void uring_seen(struct Uring *ring);
+
+int uring_buf_ring_init(struct Uring *ring, struct UringBufRing *bufs,
+                        unsigned short group, unsigned entries,
+                        unsigned size);
+void uring_buf_ring_free(struct Uring *ring, struct UringBufRing *bufs);
+char *uring_buf(struct UringBufRing *bufs, unsigned short bid);
+void uring_buf_recycle(struct UringBufRing *bufs, unsigned short bid);
+
+void uring_prep_accept(struct io_uring_sqe *sqe, int fd, int flags,
+                       uint64_t user_data);
+void uring_prep_recv(struct io_uring_sqe *sqe, int fd, unsigned short group,
+                     uint64_t user_data);
+void uring_prep_sendmsg(struct io_uring_sqe *sqe, int fd, struct msghdr *msg,
+                        int flags, uint64_t user_data);
+void uring_prep_poll(struct io_uring_sqe *sqe, int fd, unsigned mask,
+                     uint64_t user_data);
+void uring_prep_cancel(struct io_uring_sqe *sqe, uint64_t target,
+                       uint64_t user_data);
+
+#endif